@@ -0,0 +1,276 @@
+#include "batch.h"
+#include <evm.h>
+#include <eerror.h>
+#include <esourcecache.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct
+{
+    const char *path;
+
+    char *output;
+    size_t len, size;
+
+    int status;
+    bool done;
+} Job;
+
+typedef struct
+{
+    Job *jobs;
+    size_t num_jobs;
+
+    size_t next; // Next job to hand out
+    size_t printed; // Every job before this one has been printed
+    size_t failed;
+
+    pthread_mutex_t lock;
+
+    eSourceCache *sources;
+
+    eBatchOptions options;
+} Batch;
+
+typedef struct
+{
+    pthread_t thread;
+
+    Batch *batch;
+
+    Job *job; // Job the output of the VM is captured for
+} Worker;
+
+bool e_batch_read_manifest(const char *path, char ***scripts, size_t *num_scripts)
+{
+    FILE *fp = fopen(path, "r");
+    if(!fp)
+    {
+        return false;
+    }
+
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    while((len = getline(&line, &size, fp)) >= 0)
+    {
+        while(len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' '))
+        {
+            line[--len] = '\0';
+        }
+
+        if(len == 0 || line[0] == '#')
+        {
+            continue;
+        }
+
+        *scripts = realloc(*scripts, (*num_scripts + 1) * sizeof(char *));
+        if(!*scripts)
+        {
+            fprintf(stderr, "Failed to grow script list\n");
+            exit(-1);
+        }
+
+        (*scripts)[(*num_scripts)++] = strdup(line);
+    }
+
+    free(line);
+    fclose(fp);
+
+    return true;
+}
+
+static void job_append(Job *job, const char *data, size_t len)
+{
+    if(job->len + len > job->size)
+    {
+        while(job->len + len > job->size)
+        {
+            job->size = job->size == 0 ? 1024 : job->size * 2;
+        }
+
+        job->output = realloc(job->output, job->size);
+        if(!job->output)
+        {
+            fprintf(stderr, "Failed to grow output of %s\n", job->path);
+            exit(-1);
+        }
+    }
+
+    memcpy(job->output + job->len, data, len);
+    job->len += len;
+}
+
+static void capture(void *user, const char *data, size_t len)
+{
+    Worker *worker = user;
+
+    job_append(worker->job, data, len);
+}
+
+/**
+ * Results are printed in order by whichever worker finishes the job that is next in line
+*/
+static void job_finish(Batch *batch, Job *job)
+{
+    pthread_mutex_lock(&batch->lock);
+
+    job->done = true;
+    if(job->status != 0)
+    {
+        batch->failed++;
+    }
+
+    while(batch->printed < batch->num_jobs && batch->jobs[batch->printed].done)
+    {
+        Job *next = &batch->jobs[batch->printed++];
+
+        printf("==> %s (exit %d) <==\n", next->path, next->status);
+        fwrite(next->output, 1, next->len, stdout);
+
+        free(next->output);
+        next->output = NULL;
+    }
+
+    fflush(stdout);
+
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void *worker_run(void *data)
+{
+    Worker *worker = data;
+    Batch *batch = worker->batch;
+
+    eVM *vm = e_vm_new();
+    vm->stats.limit = batch->options.max_memory;
+    vm->modules->lazy = batch->options.lazy_imports;
+    vm->modules->sources = batch->sources;
+
+    e_vm_set_output(vm, capture, worker);
+
+    while(true)
+    {
+        pthread_mutex_lock(&batch->lock);
+        Job *job = batch->next < batch->num_jobs ? &batch->jobs[batch->next++] : NULL;
+        pthread_mutex_unlock(&batch->lock);
+
+        if(job == NULL)
+        {
+            break;
+        }
+
+        worker->job = job;
+
+        job->status = e_vm_exec_file(vm, job->path);
+        e_output_flush(vm->output);
+
+        if(vm->error.kind != NO_ERROR && vm->error.kind != PROGRAM_EXIT)
+        {
+            char message[PATH_MAX + 256];
+            e_error_format(&vm->error, message, sizeof(message));
+
+            job_append(job, message, strlen(message));
+        }
+
+        // Nothing a script declared or changed in a module is seen by the next one
+        e_vm_reset(vm);
+        e_vm_unload_modules(vm);
+
+        job_finish(batch, job);
+    }
+
+    e_vm_free(vm);
+
+    return NULL;
+}
+
+int e_batch_run(char **scripts, size_t num_scripts, eBatchOptions options)
+{
+    Batch batch = {
+        .jobs = calloc(num_scripts, sizeof(Job)),
+        .num_jobs = num_scripts,
+        .next = 0,
+        .printed = 0,
+        .failed = 0,
+        .sources = e_source_cache_new(),
+        .options = options
+    };
+    if(!batch.jobs && num_scripts > 0)
+    {
+        fprintf(stderr, "Failed to allocate jobs\n");
+
+        return -1;
+    }
+
+    pthread_mutex_init(&batch.lock, NULL);
+
+    for(size_t i = 0; i < num_scripts; i++)
+    {
+        batch.jobs[i].path = scripts[i];
+    }
+
+    size_t num_workers = options.threads;
+    if(num_workers == 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        num_workers = cores > 0 ? (size_t) cores : 1;
+    }
+
+    if(num_workers > num_scripts)
+    {
+        num_workers = num_scripts;
+    }
+
+    Worker *workers = calloc(num_workers, sizeof(Worker));
+    if(!workers && num_workers > 0)
+    {
+        fprintf(stderr, "Failed to allocate workers\n");
+
+        return -1;
+    }
+
+    size_t started = 0;
+    for(size_t i = 0; i < num_workers; i++)
+    {
+        workers[i].batch = &batch;
+
+        if(pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]) != 0)
+        {
+            // The workers that did start take over the remaining jobs
+            perror("pthread_create");
+
+            break;
+        }
+
+        started++;
+    }
+
+    if(started == 0 && num_workers > 0)
+    {
+        // Run everything on this thread instead
+        workers[0].batch = &batch;
+        worker_run(&workers[0]);
+    }
+
+    for(size_t i = 0; i < started; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    fprintf(stderr, "%zu scripts, %zu failed\n", batch.num_jobs, batch.failed);
+
+    int status = batch.failed == 0 ? 0 : 1;
+
+    free(workers);
+    free(batch.jobs);
+
+    pthread_mutex_destroy(&batch.lock);
+
+    e_source_cache_free(batch.sources);
+
+    return status;
+}
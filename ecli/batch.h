@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct
+{
+    size_t threads; // 0 starts one worker per core
+
+    size_t max_memory; // Limit of every script, 0 if unlimited
+
+    bool lazy_imports;
+} eBatchOptions;
+
+/**
+ * Appends the scripts listed in a manifest, one path per line.
+ * Empty lines and lines starting with '#' are skipped, returns false if the manifest couldn't be read
+*/
+bool e_batch_read_manifest(const char *path, char ***scripts, size_t *num_scripts);
+
+/**
+ * Runs every script on a pool of worker threads, each worker has its own VM and runs one script at a time.
+ * Every script starts with a fresh root scope and fresh modules, imported files are only read and lexed once for all of them.
+ * The output of a script is captured and printed with its exit status once it and all scripts before it have finished.
+ * Returns 0 if every script exited with 0
+*/
+int e_batch_run(char **scripts, size_t num_scripts, eBatchOptions options);
@@ -2,35 +2,372 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <ctype.h>
+#include <unistd.h>
 #include <elex.h>
 #include <einterpreter.h>
 #include <eerror.h>
 #include <eio.h>
 #include <estack.h>
+#include <effi.h>
+#include <elibrary.h>
+#include <evm.h>
+#include <ebundle.h>
+#include "server.h"
+#include "batch.h"
+
+#define MAX_PRELOADS 64
+
+static void usage(void)
+{
+    printf("Usage:\n");
+    printf("elang [options] <filename>\n");
+    printf("elang [options] -\n");
+    printf("elang --bundle <filename> -o <bundle>\n");
+    printf("elang [options] --serve <socket> [--preload <filename>]...\n");
+    printf("elang --client <socket> <filename>\n");
+    printf("elang [options] --batch [--jobs <n>] [--manifest <filename>] <filename>...\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  --max-memory <bytes>  Abort with a runtime error once the script uses more memory (accepts K, M and G suffixes)\n");
+    printf("  --memory-report       Print memory statistics to stderr after the script has finished\n");
+    printf("  --lazy-imports        Only load imported files once one of their members is used\n");
+    printf("  -                     Read the program from stdin and run every statement as soon as it is complete\n");
+    printf("  --bundle <filename>   Write the file and everything it imports into a single bundle that can be run instead\n");
+    printf("  -o <bundle>           Output path for --bundle\n");
+    printf("  --serve <socket>      Keep a warm interpreter and run the scripts sent to the socket, each in its own process\n");
+    printf("  --preload <filename>  Import a module before serving, so that requests find it in the module cache\n");
+    printf("  --client <socket>     Run a file, or stdin if it is -, on a server and print its output\n");
+    printf("  --batch               Run every file on a pool of threads and print the output of each one with its exit status\n");
+    printf("  --jobs <n>            Number of threads for --batch, defaults to the number of cores\n");
+    printf("  --manifest <filename> Add the files listed in a manifest to the batch, one per line\n");
+}
+
+/**
+ * Parses a number of bytes with an optional k, m or g suffix, returns false if it isn't one
+*/
+static bool parse_size(const char *txt, size_t *size)
+{
+    // strtoull would also accept whitespace and a sign, and wrap negative numbers around
+    if(!isdigit((unsigned char) txt[0]))
+    {
+        return false;
+    }
+
+    errno = 0;
+    char *end = NULL;
+    unsigned long long value = strtoull(txt, &end, 10);
+    if(errno == ERANGE || value > SIZE_MAX)
+    {
+        return false;
+    }
+
+    unsigned int shift = 0;
+    switch(*end)
+    {
+    case 'k':
+    case 'K':
+        shift = 10;
+
+        break;
+
+    case 'm':
+    case 'M':
+        shift = 20;
+
+        break;
+
+    case 'g':
+    case 'G':
+        shift = 30;
+
+        break;
+
+    case '\0':
+        break;
+
+    default:
+        return false;
+    }
+
+    if(shift != 0 && end[1] != '\0')
+    {
+        return false;
+    }
+
+    if(value > (SIZE_MAX >> shift))
+    {
+        return false;
+    }
+
+    *size = (size_t) value << shift;
+
+    return true;
+}
+
+/**
+ * Parses a plain decimal number, returns false if it isn't one
+*/
+static bool parse_count(const char *txt, size_t *count)
+{
+    if(!isdigit((unsigned char) txt[0]))
+    {
+        return false;
+    }
+
+    errno = 0;
+    char *end = NULL;
+    unsigned long long value = strtoull(txt, &end, 10);
+    if(errno == ERANGE || value > SIZE_MAX || *end != '\0')
+    {
+        return false;
+    }
+
+    *count = (size_t) value;
+
+    return true;
+}
+
+static void free_scripts(char **scripts, size_t num_scripts)
+{
+    for(size_t i = 0; i < num_scripts; i++)
+    {
+        free(scripts[i]);
+    }
+
+    free(scripts);
+}
 
 int main(int argc, char **argv)
 {
-    if(argc < 2)
+    size_t max_memory = 0;
+    bool report = false;
+    bool lazy_imports = false;
+    char *filename = NULL;
+    char *bundle_main = NULL;
+    char *bundle_out = NULL;
+    char *serve_socket = NULL;
+    char *client_socket = NULL;
+    char *preload[MAX_PRELOADS];
+    size_t num_preloads = 0;
+    bool batch = false;
+    size_t jobs = 0;
+    char *manifest = NULL;
+    char **scripts = NULL;
+    size_t num_scripts = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--max-memory") == 0 && i + 1 < argc)
+        {
+            if(!parse_size(argv[++i], &max_memory))
+            {
+                fprintf(stderr, "Invalid size: %s\n", argv[i]);
+
+                return -1;
+            }
+        }
+        else if(strcmp(argv[i], "--memory-report") == 0)
+        {
+            report = true;
+        }
+        else if(strcmp(argv[i], "--lazy-imports") == 0)
+        {
+            lazy_imports = true;
+        }
+        else if(strcmp(argv[i], "--bundle") == 0 && i + 1 < argc)
+        {
+            bundle_main = argv[++i];
+        }
+        else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            bundle_out = argv[++i];
+        }
+        else if(strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+        {
+            serve_socket = argv[++i];
+        }
+        else if(strcmp(argv[i], "--preload") == 0 && i + 1 < argc && num_preloads < MAX_PRELOADS)
+        {
+            preload[num_preloads++] = argv[++i];
+        }
+        else if(strcmp(argv[i], "--client") == 0 && i + 1 < argc)
+        {
+            client_socket = argv[++i];
+        }
+        else if(strcmp(argv[i], "--batch") == 0)
+        {
+            batch = true;
+        }
+        else if(strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+        {
+            if(!parse_count(argv[++i], &jobs))
+            {
+                fprintf(stderr, "Invalid number of jobs: %s\n", argv[i]);
+
+                return -1;
+            }
+        }
+        else if(strcmp(argv[i], "--manifest") == 0 && i + 1 < argc)
+        {
+            manifest = argv[++i];
+        }
+        else
+        {
+            filename = argv[i];
+
+            scripts = realloc(scripts, (num_scripts + 1) * sizeof(char *));
+            if(!scripts)
+            {
+                fprintf(stderr, "Failed to grow script list\n");
+
+                return -1;
+            }
+
+            scripts[num_scripts++] = strdup(argv[i]);
+        }
+    }
+
+    if(batch)
+    {
+        if(manifest != NULL && !e_batch_read_manifest(manifest, &scripts, &num_scripts))
+        {
+            fprintf(stderr, "Failed to read manifest: %s\n", manifest);
+
+            return -1;
+        }
+
+        if(num_scripts == 0)
+        {
+            usage();
+
+            return -1;
+        }
+
+        e_ffi_add_builtin(e_elibrary_init);
+
+        int status = e_batch_run(scripts, num_scripts, (eBatchOptions) {
+            .threads = jobs,
+            .max_memory = max_memory,
+            .lazy_imports = lazy_imports
+        });
+
+        free_scripts(scripts, num_scripts);
+
+        return status;
+    }
+
+    free_scripts(scripts, num_scripts);
+
+    if(bundle_main != NULL)
     {
-        printf("Usage:\n");
-        printf("elang <filename>\n");
+        if(bundle_out == NULL)
+        {
+            usage();
+
+            return -1;
+        }
+
+        if(!e_bundle_write(bundle_main, bundle_out))
+        {
+            fprintf(stderr, "Failed to write bundle: %s\n", bundle_out);
+
+            return -1;
+        }
 
         return 0;
     }
 
-    eString path = {.ptr = argv[1], .len = strlen(argv[1])};
+    if(client_socket != NULL)
+    {
+        if(filename == NULL)
+        {
+            usage();
 
-    eScope scope = e_scope_new(NULL, NULL);
+            return -1;
+        }
 
-    eFileState file = {
-        .is_main = true,
-        .path = path
-    };
+        return e_client(client_socket, filename);
+    }
 
-    e_exec_file(path, &scope, &file);
+    if(filename == NULL && serve_socket == NULL)
+    {
+        usage();
 
-    e_scope_free(&scope);
+        return 0;
+    }
 
-    return 0;
-}
+    e_ffi_add_builtin(e_elibrary_init);
+
+    eVM *vm = e_vm_new();
+    vm->stats.limit = max_memory;
+    vm->modules->lazy = lazy_imports;
+
+    if(serve_socket != NULL)
+    {
+        // Everything a request might need is loaded once, children inherit it
+        e_ffi_load_search_path(vm->natives);
+
+        for(size_t i = 0; i < num_preloads; i++)
+        {
+            e_module_load(e_module_import(&vm->root, (eString) {.ptr = preload[i], .len = strlen(preload[i])}));
+        }
+
+        int status = e_serve(serve_socket, vm);
+
+        e_vm_free(vm);
 
+        return status;
+    }
+
+    int status;
+
+    // Bundles are run from memory, imports never touch the file system
+    bool is_bundle = false;
+    eBundle *bundle = e_bundle_open(filename, &is_bundle);
+    if(bundle == NULL && is_bundle)
+    {
+        fprintf(stderr, "Invalid bundle: %s\n", filename);
+
+        e_vm_free(vm);
+
+        return -1;
+    }
+
+    if(bundle != NULL)
+    {
+        status = e_vm_exec_bundle(vm, bundle);
+    }
+    else if(strcmp(filename, "-") == 0)
+    {
+        status = e_vm_exec_stream(vm, STDIN_FILENO, filename);
+    }
+    else
+    {
+        status = e_vm_exec_file(vm, filename);
+    }
+
+    if(vm->error.kind != NO_ERROR && vm->error.kind != PROGRAM_EXIT)
+    {
+        e_error_print(&vm->error, stderr);
+    }
+
+    if(report)
+    {
+        // Whatever the script printed comes before the report
+        e_output_flush(vm->output);
+
+        e_memory_report(&vm->stats, stderr);
+    }
+
+    e_vm_free(vm);
+
+    if(bundle != NULL)
+    {
+        e_bundle_close(bundle);
+    }
+
+    return status;
+}
@@ -0,0 +1,350 @@
+#include "server.h"
+#include <eio.h>
+#include <evm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define MAX_REQUEST_LINE (PATH_MAX + 16)
+
+static bool socket_address(const char *socket_path, struct sockaddr_un *address)
+{
+    if(strlen(socket_path) >= sizeof(address->sun_path))
+    {
+        fprintf(stderr, "Socket path is too long: %s\n", socket_path);
+
+        return false;
+    }
+
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, socket_path);
+
+    return true;
+}
+
+static bool write_all(int fd, const char *data, size_t len)
+{
+    while(len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+/**
+ * Reads the request line byte by byte so that nothing of the source behind it is consumed
+*/
+static bool read_request_line(int fd, char *line, size_t size)
+{
+    size_t len = 0;
+    while(len + 1 < size)
+    {
+        char c;
+        ssize_t n = read(fd, &c, 1);
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(n <= 0)
+        {
+            return false;
+        }
+
+        if(c == '\n')
+        {
+            line[len] = '\0';
+
+            return true;
+        }
+
+        line[len++] = c;
+    }
+
+    return false;
+}
+
+/**
+ * Ends the request, the status follows everything the script has written
+*/
+static _Noreturn void finish_request(int connection, int status)
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    char trailer[E_STATUS_TRAILER_LEN];
+    memcpy(trailer, E_STATUS_MAGIC, E_STATUS_MAGIC_LEN);
+
+    uint32_t code = htonl((uint32_t) status);
+    memcpy(trailer + E_STATUS_MAGIC_LEN, &code, sizeof(code));
+
+    write_all(connection, trailer, sizeof(trailer));
+
+    exit(status);
+}
+
+static void handle_request(int connection, eVM *vm)
+{
+    char line[MAX_REQUEST_LINE];
+    if(!read_request_line(connection, line, sizeof(line)))
+    {
+        exit(-1);
+    }
+
+    // The script talks to the client from here on
+    dup2(connection, STDOUT_FILENO);
+    dup2(connection, STDERR_FILENO);
+
+    // The child is thrown away afterwards, so the request can use the root scope of the warm VM
+    int status;
+
+    if(strncmp(line, E_REQUEST_FILE, strlen(E_REQUEST_FILE)) == 0)
+    {
+        status = e_vm_exec_file(vm, line + strlen(E_REQUEST_FILE));
+    }
+    else if(strncmp(line, E_REQUEST_SOURCE, strlen(E_REQUEST_SOURCE)) == 0)
+    {
+        eArena arena = e_arena_new(65536);
+
+        eString txt = e_read_fd(&arena, connection);
+        if(!txt.ptr)
+        {
+            fprintf(stderr, "Failed to read source\n");
+
+            finish_request(connection, -1);
+        }
+
+        status = e_vm_exec_source(vm, txt.ptr, txt.len, line + strlen(E_REQUEST_SOURCE));
+
+        e_arena_free(&arena);
+    }
+    else
+    {
+        fprintf(stderr, "Unknown request: %s\n", line);
+
+        finish_request(connection, -1);
+    }
+
+    // Whatever the script printed comes before the error
+    e_output_flush(vm->output);
+
+    if(vm->error.kind != NO_ERROR && vm->error.kind != PROGRAM_EXIT)
+    {
+        e_error_print(&vm->error, stderr);
+    }
+
+    // Everything else goes away with the process
+    finish_request(connection, status);
+}
+
+int e_serve(const char *socket_path, eVM *vm)
+{
+    struct sockaddr_un address;
+    if(!socket_address(socket_path, &address))
+    {
+        return -1;
+    }
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(server < 0)
+    {
+        perror("socket");
+
+        return -1;
+    }
+
+    // Only a socket left behind by an earlier server is replaced, never anything else at that path
+    struct stat info;
+    if(lstat(socket_path, &info) == 0)
+    {
+        if(!S_ISSOCK(info.st_mode))
+        {
+            fprintf(stderr, "Not a socket: %s\n", socket_path);
+
+            close(server);
+
+            return -1;
+        }
+
+        unlink(socket_path);
+    }
+
+    if(bind(server, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(server, 64) != 0)
+    {
+        perror(socket_path);
+
+        close(server);
+
+        return -1;
+    }
+
+    // Children are reaped automatically
+    signal(SIGCHLD, SIG_IGN);
+
+    // Nothing buffered before the fork may end up in a response
+    e_output_flush(vm->output);
+
+    while(true)
+    {
+        int connection = accept(server, NULL, NULL);
+        if(connection < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            perror("accept");
+
+            break;
+        }
+
+        pid_t pid = fork();
+        if(pid == 0)
+        {
+            close(server);
+
+            handle_request(connection, vm);
+        }
+
+        if(pid < 0)
+        {
+            perror("fork");
+        }
+
+        close(connection);
+    }
+
+    close(server);
+    unlink(socket_path);
+
+    return -1;
+}
+
+int e_client(const char *socket_path, const char *filename)
+{
+    struct sockaddr_un address;
+    if(!socket_address(socket_path, &address))
+    {
+        return -1;
+    }
+
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(connection < 0 || connect(connection, (struct sockaddr *) &address, sizeof(address)) != 0)
+    {
+        perror(socket_path);
+
+        return -1;
+    }
+
+    char line[MAX_REQUEST_LINE];
+
+    if(strcmp(filename, "-") == 0)
+    {
+        // Imports of the piped source are resolved from the working directory of the client
+        char cwd[PATH_MAX];
+        if(getcwd(cwd, sizeof(cwd)) == NULL)
+        {
+            perror("getcwd");
+
+            return -1;
+        }
+
+        snprintf(line, sizeof(line), E_REQUEST_SOURCE "%s/-\n", cwd);
+        write_all(connection, line, strlen(line));
+
+        char buffer[65536];
+        ssize_t n;
+        while((n = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0 || (n < 0 && errno == EINTR))
+        {
+            if(n > 0 && !write_all(connection, buffer, n))
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        // The server may run in another directory
+        char path[PATH_MAX];
+        if(realpath(filename, path) == NULL)
+        {
+            fprintf(stderr, "Failed to open file: %s\n", filename);
+
+            return -1;
+        }
+
+        snprintf(line, sizeof(line), E_REQUEST_FILE "%s\n", path);
+        write_all(connection, line, strlen(line));
+    }
+
+    shutdown(connection, SHUT_WR);
+
+    // The last bytes received might be the status, so they are only written once more arrive
+    char buffer[E_STATUS_TRAILER_LEN + 65536];
+    size_t held = 0;
+
+    ssize_t n;
+    while((n = read(connection, buffer + held, sizeof(buffer) - held)) > 0 || (n < 0 && errno == EINTR))
+    {
+        if(n < 0)
+        {
+            continue;
+        }
+
+        size_t len = held + n;
+        if(len <= E_STATUS_TRAILER_LEN)
+        {
+            held = len;
+
+            continue;
+        }
+
+        if(!write_all(STDOUT_FILENO, buffer, len - E_STATUS_TRAILER_LEN))
+        {
+            break;
+        }
+
+        memmove(buffer, buffer + len - E_STATUS_TRAILER_LEN, E_STATUS_TRAILER_LEN);
+        held = E_STATUS_TRAILER_LEN;
+    }
+
+    close(connection);
+
+    if(held < E_STATUS_TRAILER_LEN || memcmp(buffer, E_STATUS_MAGIC, E_STATUS_MAGIC_LEN) != 0)
+    {
+        write_all(STDOUT_FILENO, buffer, held);
+
+        fprintf(stderr, "The server closed the connection without an exit status\n");
+
+        return -1;
+    }
+
+    uint32_t code;
+    memcpy(&code, buffer + E_STATUS_MAGIC_LEN, sizeof(code));
+
+    return (int32_t) ntohl(code);
+}
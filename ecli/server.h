@@ -0,0 +1,29 @@
+#pragma once
+
+#include <einterpreter.h>
+
+/**
+ * Request sent by the client, terminated by a newline:
+ *   "file <path>"   runs the file at the absolute path
+ *   "source <path>" runs the source that follows, imports are resolved relative to path
+ * The client then shuts down its side and everything the script writes is streamed back,
+ * followed by E_STATUS_MAGIC and the exit status as a 32 bit integer in network byte order.
+*/
+#define E_REQUEST_FILE "file "
+#define E_REQUEST_SOURCE "source "
+
+#define E_STATUS_MAGIC "\0status:"
+#define E_STATUS_MAGIC_LEN 8
+#define E_STATUS_TRAILER_LEN (E_STATUS_MAGIC_LEN + 4)
+
+/**
+ * Accepts requests until the process is killed, every request runs in a forked child
+ * of the warm VM and exits it with the status of the script
+*/
+int e_serve(const char *socket_path, eVM *vm);
+
+/**
+ * Sends a file, or stdin if filename is "-", to a server and copies the output to stdout.
+ * Returns the exit status of the script, or -1 if the request failed
+*/
+int e_client(const char *socket_path, const char *filename);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <effi.h>
+
+/**
+ * Entry point used when the library is linked statically as a builtin module
+*/
+eFunctionDef *e_elibrary_init(size_t *num_functions);
@@ -0,0 +1,210 @@
+#include "format.h"
+#include <eerror.h>
+#include <eio.h>
+#include <evm.h>
+#include <string.h>
+
+/**
+ * Formatted text either goes into a buffer, to the output or is only measured
+*/
+typedef struct
+{
+    char *buffer; // NULL if measuring or writing to the output
+    eOutput *output; // NULL if not writing to the output
+
+    size_t len;
+} Sink;
+
+static void sink_write(Sink *sink, const char *data, size_t len)
+{
+    if(sink->buffer != NULL)
+    {
+        memcpy(sink->buffer + sink->len, data, len);
+    }
+    else if(sink->output != NULL)
+    {
+        e_output_write(sink->output, data, len);
+    }
+
+    sink->len += len;
+}
+
+static void sink_write_int(Sink *sink, long value)
+{
+    char buffer[24];
+    char *end = buffer + sizeof(buffer);
+    char *ptr = end;
+
+    unsigned long magnitude = value < 0 ? -(unsigned long) value : (unsigned long) value;
+
+    do
+    {
+        *--ptr = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude != 0);
+
+    if(value < 0)
+    {
+        *--ptr = '-';
+    }
+
+    sink_write(sink, ptr, end - ptr);
+}
+
+static const eValue *next_argument(const eValue *args, size_t num_args, size_t *index, eValueType type)
+{
+    if(*index >= num_args)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "not enough arguments for format string", 0l);
+    }
+
+    const eValue *value = &args[(*index)++];
+    if(value->type != type)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "format argument doesn't match its placeholder", 0l);
+    }
+
+    return value;
+}
+
+static void format(Sink *sink, const eValue *args, size_t num_args)
+{
+    eString fmt = args[0].string;
+    size_t index = 1;
+
+    size_t start = 0;
+    for(size_t i = 0; i < fmt.len; i++)
+    {
+        if(fmt.ptr[i] == '\\' && i + 1 < fmt.len)
+        {
+            // String literals can't contain escapes, so format strings decode the common ones themselves
+            const char *decoded = NULL;
+            switch(fmt.ptr[i + 1])
+            {
+            case 'n':
+                decoded = "\n";
+
+                break;
+
+            case 't':
+                decoded = "\t";
+
+                break;
+
+            case '\\':
+                decoded = "\\";
+
+                break;
+
+            default:
+                // Anything else is written as it is
+                break;
+            }
+
+            if(decoded != NULL)
+            {
+                sink_write(sink, fmt.ptr + start, i - start);
+                sink_write(sink, decoded, 1);
+
+                start = ++i + 1;
+            }
+
+            continue;
+        }
+
+        if(fmt.ptr[i] != '%')
+        {
+            continue;
+        }
+
+        sink_write(sink, fmt.ptr + start, i - start);
+
+        if(++i == fmt.len)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "format string ends with a lone '%'", 0l);
+        }
+
+        switch(fmt.ptr[i])
+        {
+        case 'd':
+            sink_write_int(sink, next_argument(args, num_args, &index, VT_INT)->integer);
+
+            break;
+
+        case 'b':
+            if(next_argument(args, num_args, &index, VT_BOOL)->boolean)
+            {
+                sink_write(sink, "true", 4);
+            }
+            else
+            {
+                sink_write(sink, "false", 5);
+            }
+
+            break;
+
+        case 's':
+        {
+            const eValue *value = next_argument(args, num_args, &index, VT_STRING);
+
+            sink_write(sink, value->string.ptr, value->string.len);
+
+            break;
+        }
+
+        case '%':
+            sink_write(sink, "%", 1);
+
+            break;
+
+        default:
+            THROW_ERROR(RUNTIME_ERROR, "unknown format placeholder", 0l);
+        }
+
+        start = i + 1;
+    }
+
+    sink_write(sink, fmt.ptr + start, fmt.len - start);
+
+    if(index != num_args)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "too many arguments for format string", 0l);
+    }
+}
+
+eResult str_format(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    // Measure first so that the result only needs a single allocation
+    Sink measure = {0};
+    format(&measure, args, num_args);
+
+    eHeapString *result = e_heap_string_alloc(scope->vm->heap, measure.len);
+
+    Sink sink = {.buffer = result->data};
+    format(&sink, args, num_args);
+
+    return (eResult) {
+        .value = {
+            .type = VT_STRING,
+            .string = {
+                .ptr = result->data,
+                .len = result->len
+            },
+            .owner = result
+        },
+        .is_void = false,
+        .is_return = false
+    };
+}
+
+eResult io_printf(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    // Validate everything before anything is written
+    Sink measure = {0};
+    format(&measure, args, num_args);
+
+    Sink sink = {.output = scope->vm->output};
+    format(&sink, args, num_args);
+
+    return (eResult) {.value = {0}, .is_void = true, .is_return = false};
+}
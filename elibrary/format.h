@@ -0,0 +1,14 @@
+#pragma once
+
+#include <einterpreter.h>
+
+/**
+ * format(fmt, ...) supports %d for ints, %b for bools, %s for strings and %% for a literal percent sign.
+ * The escapes \n, \t and \\ are decoded, other backslashes are kept. The result lives on the string heap
+*/
+eResult str_format(eArena *arena, eScope *scope, const eValue *args, size_t num_args);
+
+/**
+ * Like format, but writes straight to the output buffer. Unlike print it doesn't end the line, use \n for that
+*/
+eResult io_printf(eArena *arena, eScope *scope, const eValue *args, size_t num_args);
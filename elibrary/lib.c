@@ -1,31 +1,29 @@
 #include <einterpreter.h>
+#include <eerror.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <effi.h>
+#include <evm.h>
+#include "elibrary.h"
+#include "format.h"
+#include "search.h"
+#include "stream.h"
 
-static void println(eString string)
+static eResult io_print(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
 {
-    for(size_t i = 0; i < string.len; i++)
-    {
-        putc(string.ptr[i], stdout);
-    }
-
-    putc('\n', stdout);
-}
-
-static eResult io_print(eArena *arena, eScope *scope, eStack *arguments)
-{
-    eValue value = E_STACK_POP(arguments, eValue);
+    eValue value = args[0];
 
     switch(value.type)
     {
     case VT_INT:
-        printf("%d\n", value.integer);
+        e_output_write_int(scope->vm->output, value.integer);
 
         break;
 
     case VT_STRING:
-        println(value.string);
+        e_output_write(scope->vm->output, value.string.ptr, value.string.len);
 
         break;
 
@@ -33,25 +31,310 @@ static eResult io_print(eArena *arena, eScope *scope, eStack *arguments)
         switch(value.boolean)
         {
         case true:
-            printf("true\n");
+            e_output_write(scope->vm->output, "true", 4);
 
             break;
         
         case false:
-            printf("false\n");
+            e_output_write(scope->vm->output, "false", 5);
 
             break;
         }
+
+        break;
+
+    default:
+        break;
     }
 
+    e_output_write(scope->vm->output, "\n", 1);
+
+    return (eResult) {.value = {0}, .is_void = true};
+}
+
+static eResult io_flush(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    e_output_flush(scope->vm->output);
+
     return (eResult) {.value = {0}, .is_void = true};
 }
 
-static eResult io_exit(eArena *arena, eScope *scope, eStack *arguments)
+static eResult io_exit(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    eValue value = args[0];
+
+    e_output_flush(scope->vm->output);
+
+    // Ends the program, not the process that is hosting it
+    e_error_exit(value.integer);
+}
+
+static eResult value_result(eValue value)
+{
+    return (eResult) {.value = value, .is_void = false, .is_return = false};
+}
+
+static eResult int_result(int value)
+{
+    return value_result((eValue) {.type = VT_INT, .integer = value});
+}
+
+static eResult bool_result(bool value)
+{
+    return value_result((eValue) {.type = VT_BOOL, .boolean = value});
+}
+
+/**
+ * Substrings share the buffer of the original string
+*/
+static eValue string_slice(eValue value, size_t index, size_t len)
+{
+    return (eValue) {
+        .type = VT_STRING,
+        .string = e_string_slice(value.string, index, len),
+        .owner = value.owner
+    };
+}
+
+static eResult str_len(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    return int_result(args[0].string.len);
+}
+
+static eResult str_find(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    eString haystack = args[0].string;
+    eString needle = args[1].string;
+
+    size_t index = e_search(haystack.ptr, haystack.len, needle.ptr, needle.len);
+
+    return int_result(index == E_NOT_FOUND ? -1 : (int) index);
+}
+
+static eResult str_count(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    eString haystack = args[0].string;
+    eString needle = args[1].string;
+
+    if(needle.len == 0)
+    {
+        return int_result(haystack.len + 1);
+    }
+
+    if(needle.len == 1)
+    {
+        return int_result(e_count_byte(haystack.ptr, haystack.len, needle.ptr[0]));
+    }
+
+    // Counts non overlapping occurrences
+    size_t count = 0;
+    size_t offset = 0;
+    while(offset < haystack.len)
+    {
+        size_t index = e_search(haystack.ptr + offset, haystack.len - offset, needle.ptr, needle.len);
+        if(index == E_NOT_FOUND)
+        {
+            break;
+        }
+
+        count++;
+        offset += index + needle.len;
+    }
+
+    return int_result(count);
+}
+
+static eResult str_split(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    eString haystack = args[0].string;
+    eString separator = args[1].string;
+    int field = args[2].integer;
+
+    if(separator.len == 0)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "empty separator", 0l);
+    }
+
+    if(field < 0)
+    {
+        return value_result(string_slice(args[0], 0, 0));
+    }
+
+    // Skip to the requested field
+    size_t offset = 0;
+    for(int i = 0; i < field; i++)
+    {
+        size_t index = e_search(haystack.ptr + offset, haystack.len - offset, separator.ptr, separator.len);
+        if(index == E_NOT_FOUND)
+        {
+            return value_result(string_slice(args[0], 0, 0));
+        }
+
+        offset += index + separator.len;
+    }
+
+    size_t len = e_search(haystack.ptr + offset, haystack.len - offset, separator.ptr, separator.len);
+    if(len == E_NOT_FOUND)
+    {
+        len = haystack.len - offset;
+    }
+
+    return value_result(string_slice(args[0], offset, len));
+}
+
+static eResult str_replace(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
 {
-    eValue value = E_STACK_POP(arguments, eValue);
+    eString haystack = args[0].string;
+    eString from = args[1].string;
+    eString to = args[2].string;
+
+    if(from.len == 0)
+    {
+        return value_result(args[0]);
+    }
+
+    // Measure the result first so that it can be built in a single allocation
+    size_t count = 0;
+    size_t offset = 0;
+    size_t index;
+    while((index = e_search(haystack.ptr + offset, haystack.len - offset, from.ptr, from.len)) != E_NOT_FOUND)
+    {
+        count++;
+        offset += index + from.len;
+    }
+
+    if(count == 0)
+    {
+        return value_result(args[0]);
+    }
+
+    eHeapString *result = e_heap_string_alloc(scope->vm->heap, haystack.len - count * from.len + count * to.len);
+
+    char *out = result->data;
+    offset = 0;
+    while((index = e_search(haystack.ptr + offset, haystack.len - offset, from.ptr, from.len)) != E_NOT_FOUND)
+    {
+        memcpy(out, haystack.ptr + offset, index);
+        out += index;
+
+        memcpy(out, to.ptr, to.len);
+        out += to.len;
 
-    exit(value.integer);
+        offset += index + from.len;
+    }
+
+    memcpy(out, haystack.ptr + offset, haystack.len - offset);
+
+    return value_result((eValue) {
+        .type = VT_STRING,
+        .string = {
+            .ptr = result->data,
+            .len = result->len
+        },
+        .owner = result
+    });
+}
+
+static eResult str_starts_with(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    eString string = args[0].string;
+    eString prefix = args[1].string;
+
+    return bool_result(prefix.len <= string.len && memcmp(string.ptr, prefix.ptr, prefix.len) == 0);
+}
+
+static eResult str_to_int(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    eString string = args[0].string;
+
+    size_t i = 0;
+    bool negative = false;
+    if(i < string.len && (string.ptr[i] == '-' || string.ptr[i] == '+'))
+    {
+        negative = string.ptr[i] == '-';
+        i++;
+    }
+
+    if(i == string.len)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "invalid integer", 0l);
+    }
+
+    // The magnitude of INT_MIN is one more than INT_MAX
+    unsigned long limit = negative ? (unsigned long) INT_MAX + 1 : (unsigned long) INT_MAX;
+
+    unsigned long value = 0;
+    for(; i < string.len; i++)
+    {
+        char c = string.ptr[i];
+        if(c < '0' || c > '9')
+        {
+            THROW_ERROR(RUNTIME_ERROR, "invalid integer", 0l);
+        }
+
+        unsigned long digit = c - '0';
+        if(value > (limit - digit) / 10)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "invalid integer", 0l);
+        }
+
+        value = value * 10 + digit;
+    }
+
+    if(value == 0)
+    {
+        return int_result(0);
+    }
+
+    return int_result(negative ? -(int) (value - 1) - 1 : (int) value);
+}
+
+static eResult str_from_int(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    char buffer[16];
+    char *end = buffer + sizeof(buffer);
+    char *ptr = end;
+
+    long value = args[0].integer;
+    bool negative = value < 0;
+    if(negative)
+    {
+        value = -value;
+    }
+
+    do
+    {
+        *--ptr = '0' + value % 10;
+        value /= 10;
+    } while(value != 0);
+
+    if(negative)
+    {
+        *--ptr = '-';
+    }
+
+    return value_result(e_value_new_string(scope, (eString) {.ptr = ptr, .len = end - ptr}));
+}
+
+static int math_abs(int a)
+{
+    if(a == INT_MIN)
+    {
+        // Its absolute value isn't an int
+        THROW_ERROR(RUNTIME_ERROR, "integer overflow", 0l);
+    }
+
+    return a < 0 ? -a : a;
+}
+
+static int math_min(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+static int math_max(int a, int b)
+{
+    return a > b ? a : b;
 }
 
 static eFunctionDef function_table[] =
@@ -59,18 +342,188 @@ static eFunctionDef function_table[] =
     {
         .name = (eString) {.ptr = "print", .len = 5},
         .ptr = io_print,
-        .num_args = 1
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_ANY},
+        .return_type = VT_VOID
+    },
+    {
+        .name = (eString) {.ptr = "flush", .len = 5},
+        .ptr = io_flush,
+        .num_args = 0,
+        .param_types = NULL,
+        .return_type = VT_VOID
     },
     {
         .name = (eString) {.ptr = "exit", .len = 4},
         .ptr = io_exit,
-        .num_args = 1
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_INT},
+        .return_type = VT_VOID
+    },
+    {
+        .name = (eString) {.ptr = "len", .len = 3},
+        .ptr = str_len,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_STRING},
+        .return_type = VT_INT,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "find", .len = 4},
+        .ptr = str_find,
+        .num_args = 2,
+        .param_types = (eValueType[]) {VT_STRING, VT_STRING},
+        .return_type = VT_INT,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "count", .len = 5},
+        .ptr = str_count,
+        .num_args = 2,
+        .param_types = (eValueType[]) {VT_STRING, VT_STRING},
+        .return_type = VT_INT,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "split", .len = 5},
+        .ptr = str_split,
+        .num_args = 3,
+        .param_types = (eValueType[]) {VT_STRING, VT_STRING, VT_INT},
+        .return_type = VT_STRING,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "replace", .len = 7},
+        .ptr = str_replace,
+        .num_args = 3,
+        .param_types = (eValueType[]) {VT_STRING, VT_STRING, VT_STRING},
+        .return_type = VT_STRING,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "starts_with", .len = 11},
+        .ptr = str_starts_with,
+        .num_args = 2,
+        .param_types = (eValueType[]) {VT_STRING, VT_STRING},
+        .return_type = VT_BOOL,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "to_int", .len = 6},
+        .ptr = str_to_int,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_STRING},
+        .return_type = VT_INT,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "from_int", .len = 8},
+        .ptr = str_from_int,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_INT},
+        .return_type = VT_STRING,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "abs", .len = 3},
+        .int_unary = math_abs,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_INT},
+        .return_type = VT_INT,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "min", .len = 3},
+        .int_binary = math_min,
+        .num_args = 2,
+        .param_types = (eValueType[]) {VT_INT, VT_INT},
+        .return_type = VT_INT,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "max", .len = 3},
+        .int_binary = math_max,
+        .num_args = 2,
+        .param_types = (eValueType[]) {VT_INT, VT_INT},
+        .return_type = VT_INT,
+        .pure = true
+    },
+    {
+        .name = (eString) {.ptr = "format", .len = 6},
+        .ptr = str_format,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_STRING},
+        .return_type = VT_STRING,
+        .pure = true,
+        .variadic = true
+    },
+    {
+        .name = (eString) {.ptr = "printf", .len = 6},
+        .ptr = io_printf,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_STRING},
+        .return_type = VT_VOID,
+        .variadic = true
+    },
+    {
+        .name = (eString) {.ptr = "read_file", .len = 9},
+        .ptr = io_read_file,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_STRING},
+        .return_type = VT_STRING
+    },
+    {
+        .name = (eString) {.ptr = "write_file", .len = 10},
+        .ptr = io_write_file,
+        .num_args = 2,
+        .param_types = (eValueType[]) {VT_STRING, VT_STRING},
+        .return_type = VT_VOID
+    },
+    {
+        .name = (eString) {.ptr = "write", .len = 5},
+        .ptr = io_write,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_STRING},
+        .return_type = VT_VOID
+    },
+    {
+        .name = (eString) {.ptr = "open", .len = 4},
+        .ptr = io_open,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_STRING},
+        .return_type = VT_INT
+    },
+    {
+        .name = (eString) {.ptr = "read_line", .len = 9},
+        .ptr = io_read_line,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_INT},
+        .return_type = VT_STRING
+    },
+    {
+        .name = (eString) {.ptr = "eof", .len = 3},
+        .ptr = io_eof,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_INT},
+        .return_type = VT_BOOL
+    },
+    {
+        .name = (eString) {.ptr = "close", .len = 5},
+        .ptr = io_close,
+        .num_args = 1,
+        .param_types = (eValueType[]) {VT_INT},
+        .return_type = VT_VOID
     }
 };
 
-eFunctionDef *e_mod_init(size_t *num_functions)
+eFunctionDef *e_elibrary_init(size_t *num_functions)
 {
     *num_functions = sizeof(function_table) / sizeof(function_table[0]);
 
     return function_table;
 }
+
+eFunctionDef *e_mod_init(size_t *num_functions)
+{
+    return e_elibrary_init(num_functions);
+}
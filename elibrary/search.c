@@ -0,0 +1,177 @@
+#include "search.h"
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_X86
+#endif
+
+static size_t search_scalar(const char *haystack, size_t n, const char *needle, size_t m, size_t start)
+{
+    for(size_t i = start; i + m <= n; i++)
+    {
+        if(haystack[i] == needle[0] && memcmp(haystack + i, needle, m) == 0)
+        {
+            return i;
+        }
+    }
+
+    return E_NOT_FOUND;
+}
+
+#ifdef HAVE_X86
+
+// Compares the first and the last byte of the needle against 16/32 positions at once and only runs memcmp on candidates
+
+static size_t search_sse2(const char *haystack, size_t n, const char *needle, size_t m)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+
+    size_t i = 0;
+    for(; i + m - 1 + 16 <= n; i += 16)
+    {
+        __m128i block_first = _mm_loadu_si128((const __m128i *) (haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *) (haystack + i + m - 1));
+
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last)));
+        while(mask != 0)
+        {
+            size_t bit = __builtin_ctz(mask);
+            if(memcmp(haystack + i + bit, needle, m) == 0)
+            {
+                return i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    return search_scalar(haystack, n, needle, m, i);
+}
+
+__attribute__((target("avx2")))
+static size_t search_avx2(const char *haystack, size_t n, const char *needle, size_t m)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+
+    size_t i = 0;
+    for(; i + m - 1 + 32 <= n; i += 32)
+    {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *) (haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *) (haystack + i + m - 1));
+
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last)));
+        while(mask != 0)
+        {
+            size_t bit = __builtin_ctz(mask);
+            if(memcmp(haystack + i + bit, needle, m) == 0)
+            {
+                return i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    return search_scalar(haystack, n, needle, m, i);
+}
+
+static size_t count_sse2(const char *haystack, size_t n, char c)
+{
+    const __m128i needle = _mm_set1_epi8(c);
+
+    size_t count = 0;
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *) (haystack + i));
+
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(needle, block)));
+    }
+
+    for(; i < n; i++)
+    {
+        count += haystack[i] == c;
+    }
+
+    return count;
+}
+
+__attribute__((target("avx2")))
+static size_t count_avx2(const char *haystack, size_t n, char c)
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+
+    size_t count = 0;
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i *) (haystack + i));
+
+        count += __builtin_popcount((uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(needle, block)));
+    }
+
+    for(; i < n; i++)
+    {
+        count += haystack[i] == c;
+    }
+
+    return count;
+}
+
+#endif
+
+size_t e_search(const char *haystack, size_t n, const char *needle, size_t m)
+{
+    if(m == 0)
+    {
+        return 0;
+    }
+
+    if(m > n)
+    {
+        return E_NOT_FOUND;
+    }
+
+    if(m == 1)
+    {
+        // memchr already is vectorized by the C library
+        const char *found = memchr(haystack, needle[0], n);
+
+        return found != NULL ? (size_t) (found - haystack) : E_NOT_FOUND;
+    }
+
+#ifdef HAVE_X86
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return search_avx2(haystack, n, needle, m);
+    }
+
+    return search_sse2(haystack, n, needle, m);
+#else
+    return search_scalar(haystack, n, needle, m, 0);
+#endif
+}
+
+size_t e_count_byte(const char *haystack, size_t n, char c)
+{
+#ifdef HAVE_X86
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return count_avx2(haystack, n, c);
+    }
+
+    return count_sse2(haystack, n, c);
+#else
+    size_t count = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        count += haystack[i] == c;
+    }
+
+    return count;
+#endif
+}
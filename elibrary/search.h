@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stddef.h>
+
+#define E_NOT_FOUND ((size_t) -1)
+
+/**
+ * Returns the index of the first occurrence of needle in haystack or E_NOT_FOUND
+*/
+size_t e_search(const char *haystack, size_t n, const char *needle, size_t m);
+
+/**
+ * Counts the occurrences of a single byte
+*/
+size_t e_count_byte(const char *haystack, size_t n, char c);
@@ -0,0 +1,386 @@
+#include "stream.h"
+#include <eerror.h>
+#include <eio.h>
+#include <evm.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define READ_BUFFER_SIZE 65536
+
+static eResult void_result(void)
+{
+    return (eResult) {.value = {0}, .is_void = true, .is_return = false};
+}
+
+static eResult string_result(eString string, eHeapString *owner)
+{
+    return (eResult) {
+        .value = {
+            .type = VT_STRING,
+            .string = string,
+            .owner = owner
+        },
+        .is_void = false,
+        .is_return = false
+    };
+}
+
+static char *c_path(eArena *arena, eString path)
+{
+    char *tmp = e_arena_alloc(arena, path.len + 1);
+    memcpy(tmp, path.ptr, path.len);
+    tmp[path.len] = '\0';
+
+    return tmp;
+}
+
+static void unmap(void *data, size_t len)
+{
+    munmap(data, len);
+}
+
+static void release(void *data, size_t len)
+{
+    free(data);
+}
+
+/**
+ * Maps a regular file into a heap string, returns NULL for empty files and files that can't be mapped
+*/
+static eHeapString *map_file(eStringHeap *heap, int fd)
+{
+    struct stat info;
+    if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0)
+    {
+        return NULL;
+    }
+
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+    return e_heap_string_external(heap, data, info.st_size, unmap);
+}
+
+/**
+ * Handles are only valid in the interpreter that opened them
+*/
+static eStream *get_stream(eScope *scope, const eValue *handle)
+{
+    eStreamTable *table = &scope->vm->streams;
+
+    int index = handle->integer;
+    if(index < 0 || index >= E_MAX_STREAMS || !table->streams[index].used)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "invalid stream", 0l);
+    }
+
+    return &table->streams[index];
+}
+
+/**
+ * Makes sure the buffer contains a whole line or everything up to the end of the input
+*/
+static void fill_buffer(eStream *stream)
+{
+    while(!stream->at_end && memchr(stream->buffer + stream->start, '\n', stream->end - stream->start) == NULL)
+    {
+        // Move the partial line to the front, grow the buffer for lines that don't fit
+        memmove(stream->buffer, stream->buffer + stream->start, stream->end - stream->start);
+        stream->end -= stream->start;
+        stream->start = 0;
+
+        if(stream->end == stream->size)
+        {
+            stream->size *= 2;
+            stream->buffer = realloc(stream->buffer, stream->size);
+            if(!stream->buffer)
+            {
+                THROW_ERROR(RUNTIME_ERROR, "failed to grow read buffer", 0l);
+            }
+        }
+
+        ssize_t n = read(stream->fd, stream->buffer + stream->end, stream->size - stream->end);
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(n <= 0)
+        {
+            stream->at_end = true;
+        }
+        else
+        {
+            stream->end += n;
+        }
+    }
+}
+
+eResult io_read_file(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    int fd = open(c_path(arena, args[0].string), O_RDONLY);
+    if(fd < 0)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to open file", 0l);
+    }
+
+    eHeapString *mapping = map_file(scope->vm->heap, fd);
+    if(mapping != NULL)
+    {
+        close(fd);
+
+        return string_result((eString) {.ptr = mapping->external, .len = mapping->len}, mapping);
+    }
+
+    // Not mappable, read it in one go growing the buffer in place
+    size_t size = 0, len = 0;
+    char *buffer = NULL;
+    while(true)
+    {
+        if(len == size)
+        {
+            size = size == 0 ? READ_BUFFER_SIZE : size * 2;
+
+            char *bigger = realloc(buffer, size);
+            if(!bigger)
+            {
+                free(buffer);
+                close(fd);
+
+                THROW_ERROR(RUNTIME_ERROR, "failed to grow read buffer", 0l);
+            }
+
+            buffer = bigger;
+        }
+
+        ssize_t n = read(fd, buffer + len, size - len);
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(n <= 0)
+        {
+            break;
+        }
+
+        len += n;
+    }
+
+    close(fd);
+
+    if(len == 0)
+    {
+        free(buffer);
+
+        return string_result((eString) {.ptr = "", .len = 0}, NULL);
+    }
+
+    // Give back what the last doubling didn't use
+    char *trimmed = realloc(buffer, len);
+    if(trimmed != NULL)
+    {
+        buffer = trimmed;
+    }
+
+    eHeapString *string = e_heap_string_external(scope->vm->heap, buffer, len, release);
+
+    return string_result((eString) {.ptr = string->external, .len = string->len}, string);
+}
+
+static void write_all(int fd, const char *data, size_t len)
+{
+    while(len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            THROW_ERROR(RUNTIME_ERROR, "failed to write file", 0l);
+        }
+
+        data += n;
+        len -= n;
+    }
+}
+
+eResult io_write_file(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    int fd = open(c_path(arena, args[0].string), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to open file", 0l);
+    }
+
+    write_all(fd, args[1].string.ptr, args[1].string.len);
+
+    close(fd);
+
+    return void_result();
+}
+
+eResult io_write(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    e_output_write(scope->vm->output, args[0].string.ptr, args[0].string.len);
+
+    return void_result();
+}
+
+eResult io_open(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    eString path = args[0].string;
+
+    int fd = STDIN_FILENO;
+    if(!(path.len == 1 && path.ptr[0] == '-'))
+    {
+        fd = open(c_path(arena, path), O_RDONLY);
+        if(fd < 0)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "failed to open file", 0l);
+        }
+    }
+
+    eStreamTable *table = &scope->vm->streams;
+
+    int index = -1;
+    for(int i = 0; i < E_MAX_STREAMS; i++)
+    {
+        if(!table->streams[i].used)
+        {
+            index = i;
+
+            break;
+        }
+    }
+
+    if(index < 0)
+    {
+        if(fd != STDIN_FILENO)
+        {
+            close(fd);
+        }
+
+        THROW_ERROR(RUNTIME_ERROR, "too many open streams", 0l);
+    }
+
+    eStream *stream = &table->streams[index];
+    *stream = (eStream) {
+        .used = true,
+        .mapping = NULL,
+        .offset = 0,
+        .fd = fd,
+        .buffer = NULL,
+        .start = 0,
+        .end = 0,
+        .size = 0,
+        .at_end = false
+    };
+
+    stream->mapping = map_file(scope->vm->heap, fd);
+    if(stream->mapping != NULL)
+    {
+        // The stream keeps the mapping alive, lines handed out keep their own reference
+        e_heap_retain(stream->mapping);
+    }
+    else
+    {
+        stream->size = READ_BUFFER_SIZE;
+        stream->buffer = malloc(stream->size);
+        if(!stream->buffer)
+        {
+            // The slot is free again and the file is closed
+            e_stream_close(stream, scope->vm->heap);
+
+            THROW_ERROR(RUNTIME_ERROR, "failed to allocate read buffer", 0l);
+        }
+    }
+
+    return (eResult) {
+        .value = {.type = VT_INT, .integer = index},
+        .is_void = false,
+        .is_return = false
+    };
+}
+
+eResult io_read_line(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    eStream *stream = get_stream(scope, &args[0]);
+
+    if(stream->mapping != NULL)
+    {
+        eString contents = {.ptr = stream->mapping->external, .len = stream->mapping->len};
+
+        char *start = contents.ptr + stream->offset;
+        size_t remaining = contents.len - stream->offset;
+
+        char *newline = memchr(start, '\n', remaining);
+        size_t len = newline != NULL ? (size_t) (newline - start) : remaining;
+
+        stream->offset += newline != NULL ? len + 1 : len;
+
+        return string_result((eString) {.ptr = start, .len = len}, stream->mapping);
+    }
+
+    fill_buffer(stream);
+
+    char *start = stream->buffer + stream->start;
+    size_t remaining = stream->end - stream->start;
+
+    char *newline = memchr(start, '\n', remaining);
+    size_t len = newline != NULL ? (size_t) (newline - start) : remaining;
+
+    stream->start += newline != NULL ? len + 1 : len;
+
+    // The buffer gets reused, so the line has to be copied
+    eHeapString *line = e_heap_string_alloc(scope->vm->heap, len);
+    memcpy(line->data, start, len);
+
+    return string_result((eString) {.ptr = line->data, .len = len}, line);
+}
+
+eResult io_eof(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    eStream *stream = get_stream(scope, &args[0]);
+
+    bool eof;
+    if(stream->mapping != NULL)
+    {
+        eof = stream->offset >= stream->mapping->len;
+    }
+    else
+    {
+        if(stream->start == stream->end)
+        {
+            fill_buffer(stream);
+        }
+
+        eof = stream->at_end && stream->start == stream->end;
+    }
+
+    return (eResult) {
+        .value = {.type = VT_BOOL, .boolean = eof},
+        .is_void = false,
+        .is_return = false
+    };
+}
+
+eResult io_close(eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    e_stream_close(get_stream(scope, &args[0]), scope->vm->heap);
+
+    return void_result();
+}
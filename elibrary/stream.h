@@ -0,0 +1,17 @@
+#pragma once
+
+#include <einterpreter.h>
+
+eResult io_read_file(eArena *arena, eScope *scope, const eValue *args, size_t num_args);
+
+eResult io_write_file(eArena *arena, eScope *scope, const eValue *args, size_t num_args);
+
+eResult io_write(eArena *arena, eScope *scope, const eValue *args, size_t num_args);
+
+eResult io_open(eArena *arena, eScope *scope, const eValue *args, size_t num_args);
+
+eResult io_read_line(eArena *arena, eScope *scope, const eValue *args, size_t num_args);
+
+eResult io_eof(eArena *arena, eScope *scope, const eValue *args, size_t num_args);
+
+eResult io_close(eArena *arena, eScope *scope, const eValue *args, size_t num_args);
@@ -1,9 +1,35 @@
 #include "earena.h"
+#include "eerror.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 
-static eArenaRegion *region_new(size_t size)
+static const char *category_names[EMEM_CATEGORY_COUNT] = {
+    [EMEM_VALUES] = "values",
+    [EMEM_SOURCE] = "source",
+    [EMEM_TOKENS] = "tokens",
+    [EMEM_AST] = "ast",
+    [EMEM_STRINGS] = "strings"
+};
+
+static bool within_limit(const eMemoryStats *stats, size_t size)
+{
+    return stats->limit == 0 || stats->used + size <= stats->limit;
+}
+
+static eArenaRegion *region_new(eMemoryStats *stats, size_t size)
 {
+    if(stats != NULL)
+    {
+        e_memory_acquire(stats, size);
+
+        stats->regions++;
+        if(stats->regions > stats->peak_regions)
+        {
+            stats->peak_regions = stats->regions;
+        }
+    }
+
     eArenaRegion *region = calloc(1, sizeof(eArenaRegion));
     region->ptr = calloc(size, 1);
     region->size = size;
@@ -13,30 +39,56 @@ static eArenaRegion *region_new(size_t size)
     return region;
 }
 
-static void region_free(eArenaRegion *region)
+static void region_free(eMemoryStats *stats, eArenaRegion *region)
 {
+    if(stats != NULL)
+    {
+        e_memory_release(stats, region->size);
+
+        stats->regions--;
+    }
+
     free(region->ptr);
     free(region);
 }
 
 eArena e_arena_new(size_t size)
 {
-    eArenaRegion *region = region_new(size);
+    return e_arena_new_tracked(size, NULL);
+}
+
+eArena e_arena_new_tracked(size_t size, eMemoryStats *stats)
+{
+    eArenaRegion *region = region_new(stats, size);
 
     return (eArena) {
         .regions = region,
-        .current = region
+        .current = region,
+        .resources = NULL,
+        .stats = stats,
+        .category = EMEM_VALUES
     };
 }
 
 void e_arena_free(eArena *arena)
 {
+    // Resource nodes live in the regions, so they have to be released first
+    for(eArenaResource *resource = arena->resources; resource != NULL; resource = resource->next)
+    {
+        resource->release(resource->ptr, resource->size);
+
+        if(arena->stats != NULL)
+        {
+            e_memory_release(arena->stats, resource->size);
+        }
+    }
+
     eArenaRegion *current = arena->regions;
     while(current != NULL)
     {
         eArenaRegion *tmp = current->next;
 
-        region_free(current);
+        region_free(arena->stats, current);
 
         current = tmp;
     }
@@ -48,14 +100,19 @@ void *e_arena_alloc(eArena *arena, size_t size)
     {
         if(size >= arena->regions->size)
         {
-            arena->regions->next = region_new(size);
+            arena->current->next = region_new(arena->stats, size);
         }
         else
         {
-            arena->regions->next = region_new(arena->regions->size);
+            arena->current->next = region_new(arena->stats, arena->regions->size);
         }
 
-        arena->current = arena->regions->next;
+        arena->current = arena->current->next;
+    }
+
+    if(arena->stats != NULL)
+    {
+        arena->stats->by_category[arena->category] += size;
     }
 
     void *ptr = arena->current->ptr + arena->current->used;
@@ -63,3 +120,70 @@ void *e_arena_alloc(eArena *arena, size_t size)
 
     return ptr;
 }
+
+void e_arena_attach(eArena *arena, void *ptr, size_t size, eArenaRelease release)
+{
+    if(arena->stats != NULL && !within_limit(arena->stats, size))
+    {
+        // The arena was supposed to own it
+        release(ptr, size);
+
+        THROW_ERROR(RUNTIME_ERROR, "memory limit exceeded", 0l);
+    }
+
+    eArenaResource *resource = e_arena_alloc(arena, sizeof(eArenaResource));
+    *resource = (eArenaResource) {
+        .ptr = ptr,
+        .size = size,
+        .release = release,
+        .next = arena->resources
+    };
+
+    arena->resources = resource;
+
+    if(arena->stats != NULL)
+    {
+        // Mapped and read files count against the limit like regions do
+        e_memory_acquire(arena->stats, size);
+
+        arena->stats->by_category[arena->category] += size;
+    }
+}
+
+eMemoryCategory e_arena_set_category(eArena *arena, eMemoryCategory category)
+{
+    eMemoryCategory previous = arena->category;
+    arena->category = category;
+
+    return previous;
+}
+
+void e_memory_acquire(eMemoryStats *stats, size_t size)
+{
+    if(!within_limit(stats, size))
+    {
+        THROW_ERROR(RUNTIME_ERROR, "memory limit exceeded", 0l);
+    }
+
+    stats->used += size;
+    if(stats->used > stats->peak)
+    {
+        stats->peak = stats->used;
+    }
+}
+
+void e_memory_release(eMemoryStats *stats, size_t size)
+{
+    stats->used -= size;
+}
+
+void e_memory_report(eMemoryStats *stats, FILE *fp)
+{
+    fprintf(fp, "peak memory: %zu bytes\n", stats->peak);
+    fprintf(fp, "peak regions: %zu\n", stats->peak_regions);
+
+    for(size_t i = 0; i < EMEM_CATEGORY_COUNT; i++)
+    {
+        fprintf(fp, "  %-8s %zu bytes\n", category_names[i], stats->by_category[i]);
+    }
+}
@@ -1,9 +1,35 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdio.h>
 
 typedef struct earenaregion eArenaRegion;
 
+typedef enum
+{
+    EMEM_VALUES,
+    EMEM_SOURCE,
+    EMEM_TOKENS,
+    EMEM_AST,
+    EMEM_STRINGS,
+
+    EMEM_CATEGORY_COUNT
+} eMemoryCategory;
+
+/**
+ * Memory accounting shared by all arenas of an interpreter
+*/
+typedef struct
+{
+    size_t limit; // 0 if unlimited
+
+    size_t used, peak;
+
+    size_t regions, peak_regions;
+
+    size_t by_category[EMEM_CATEGORY_COUNT]; // Total bytes handed out per category
+} eMemoryStats;
+
 struct earenaregion
 {
     void *ptr;
@@ -14,13 +40,57 @@ struct earenaregion
     eArenaRegion *next;
 };
 
+typedef void(* eArenaRelease)(void *ptr, size_t size);
+
+typedef struct earenaresource eArenaResource;
+
+/**
+ * Memory the arena didn't allocate but releases when it is freed, such as a mapped file
+*/
+struct earenaresource
+{
+    void *ptr;
+    size_t size;
+
+    eArenaRelease release;
+
+    eArenaResource *next;
+};
+
 typedef struct
 {
     eArenaRegion *regions, *current;
+
+    eArenaResource *resources;
+
+    eMemoryStats *stats; // NULL if untracked
+    eMemoryCategory category;
 } eArena;
 
 eArena e_arena_new(size_t size);
 
+eArena e_arena_new_tracked(size_t size, /* Nullable */ eMemoryStats *stats);
+
 void e_arena_free(eArena *arena);
 
 void *e_arena_alloc(eArena *arena, size_t size);
+
+/**
+ * Hands memory over to the arena, it is released when the arena is freed and accounted to the current category.
+ * It counts against the limit, if that is exceeded the memory is released right away and a runtime error is thrown
+*/
+void e_arena_attach(eArena *arena, void *ptr, size_t size, eArenaRelease release);
+
+/**
+ * Sets the category following allocations are accounted to and returns the previous one
+*/
+eMemoryCategory e_arena_set_category(eArena *arena, eMemoryCategory category);
+
+/**
+ * Accounts bytes allocated outside of an arena, throws a runtime error if the limit is exceeded
+*/
+void e_memory_acquire(eMemoryStats *stats, size_t size);
+
+void e_memory_release(eMemoryStats *stats, size_t size);
+
+void e_memory_report(eMemoryStats *stats, FILE *fp);
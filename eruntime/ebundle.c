@@ -0,0 +1,260 @@
+#include "ebundle.h"
+#include "eerror.h"
+#include "eio.h"
+#include "elex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+eBundle *e_bundle_open(const char *path, bool *is_bundle)
+{
+    if(is_bundle != NULL)
+    {
+        *is_bundle = false;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(eBundleHeader))
+    {
+        close(fd);
+
+        return NULL;
+    }
+
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    size_t size = info.st_size;
+    const eBundleHeader *header = data;
+    if(memcmp(header->magic, E_BUNDLE_MAGIC, sizeof(E_BUNDLE_MAGIC)) != 0)
+    {
+        munmap(data, size);
+
+        return NULL;
+    }
+
+    // From here on the file is a bundle, just not necessarily a valid one
+    if(is_bundle != NULL)
+    {
+        *is_bundle = true;
+    }
+
+    if(header->version != E_BUNDLE_VERSION ||
+       header->num_entries == 0 ||
+       sizeof(eBundleHeader) + (size_t) header->num_entries * sizeof(eBundleIndexEntry) > size)
+    {
+        munmap(data, size);
+
+        return NULL;
+    }
+
+    eBundle *bundle = malloc(sizeof(eBundle));
+    eBundleEntry *entries = malloc(header->num_entries * sizeof(eBundleEntry));
+    if(!bundle || !entries)
+    {
+        free(bundle);
+        free(entries);
+        munmap(data, size);
+
+        return NULL;
+    }
+
+    const eBundleIndexEntry *index = (const eBundleIndexEntry *) (header + 1);
+    for(uint32_t i = 0; i < header->num_entries; i++)
+    {
+        if((size_t) index[i].path_offset + index[i].path_len > size ||
+           (size_t) index[i].source_offset + index[i].source_len > size)
+        {
+            free(bundle);
+            free(entries);
+            munmap(data, size);
+
+            return NULL;
+        }
+
+        entries[i] = (eBundleEntry) {
+            .path = {.ptr = (char *) data + index[i].path_offset, .len = index[i].path_len},
+            .source = {.ptr = (char *) data + index[i].source_offset, .len = index[i].source_len}
+        };
+    }
+
+    *bundle = (eBundle) {
+        .data = data,
+        .size = size,
+        .entries = entries,
+        .num_entries = header->num_entries
+    };
+
+    return bundle;
+}
+
+void e_bundle_close(eBundle *bundle)
+{
+    munmap(bundle->data, bundle->size);
+
+    free(bundle->entries);
+    free(bundle);
+}
+
+eString e_bundle_find(eBundle *bundle, eString path)
+{
+    for(size_t i = 0; i < bundle->num_entries; i++)
+    {
+        if(e_string_compare(bundle->entries[i].path, path))
+        {
+            return bundle->entries[i].source;
+        }
+    }
+
+    return (eString) {.ptr = NULL, .len = 0};
+}
+
+bool e_bundle_write(const char *main_path, const char *out_path)
+{
+    eArena arena = e_arena_new(4096);
+
+    eString main = {.ptr = (char *) main_path, .len = strlen(main_path)};
+    eString directory = e_string_slice_file_path(main);
+
+    // Entries are added while walking the import graph, every file is lexed once
+    eList entries = {0};
+    e_list_push(&arena, &entries, &(eBundleEntry) {
+        .path = e_string_normalize_path(&arena, e_string_slice(main, directory.len, main.len - directory.len))
+    }, sizeof(eBundleEntry));
+
+    eListIter iter = e_list_iter(&entries);
+    eBundleEntry *entry;
+    while((entry = e_list_next(&iter)) != NULL)
+    {
+        entry->source = e_read_file(&arena, e_string_combine(&arena, directory, entry->path));
+        if(!entry->source.ptr)
+        {
+            fprintf(stderr, "Failed to open file: %.*s\n", (int) entry->path.len, entry->path.ptr);
+
+            e_arena_free(&arena);
+
+            return false;
+        }
+
+        eString current_path = e_string_slice_file_path(entry->path);
+
+        eList tokens = e_lex(&arena, entry->source);
+        eListIter token_iter = e_list_iter(&tokens);
+        eToken *tk;
+        while((tk = e_list_next(&token_iter)) != NULL)
+        {
+            if(tk->tag != ETK_KEYWORD_IMPORT)
+            {
+                continue;
+            }
+
+            eToken *path_tk = e_list_next(&token_iter);
+            if(path_tk == NULL || path_tk->tag != ETK_STRING)
+            {
+                continue;
+            }
+
+            // Imports are resolved the same way the interpreter resolves them inside a bundle
+            eString path = e_string_slice(entry->source, path_tk->start + 1, path_tk->len - 2);
+            eString key = e_string_normalize_path(&arena, e_string_combine(&arena, current_path, path));
+
+            bool known = false;
+            eListIter known_iter = e_list_iter(&entries);
+            eBundleEntry *other;
+            while((other = e_list_next(&known_iter)) != NULL)
+            {
+                if(e_string_compare(other->path, key))
+                {
+                    known = true;
+
+                    break;
+                }
+            }
+
+            if(!known)
+            {
+                e_list_push(&arena, &entries, &(eBundleEntry) {.path = key}, sizeof(eBundleEntry));
+            }
+        }
+    }
+
+    // Offsets and lengths in the index are 32 bit
+    size_t num_entries = e_list_len(&entries);
+    size_t total = sizeof(eBundleHeader) + num_entries * sizeof(eBundleIndexEntry);
+
+    iter = e_list_iter(&entries);
+    while((entry = e_list_next(&iter)) != NULL)
+    {
+        total += entry->path.len + entry->source.len;
+    }
+
+    if(total > UINT32_MAX)
+    {
+        fprintf(stderr, "Bundle would be larger than 4 GiB\n");
+
+        e_arena_free(&arena);
+
+        return false;
+    }
+
+    FILE *fp = fopen(out_path, "wb");
+    if(!fp)
+    {
+        e_arena_free(&arena);
+
+        return false;
+    }
+
+    eBundleHeader header = {
+        .version = E_BUNDLE_VERSION,
+        .num_entries = num_entries
+    };
+    memcpy(header.magic, E_BUNDLE_MAGIC, sizeof(E_BUNDLE_MAGIC));
+
+    fwrite(&header, sizeof(header), 1, fp);
+
+    size_t offset = sizeof(eBundleHeader) + num_entries * sizeof(eBundleIndexEntry);
+
+    iter = e_list_iter(&entries);
+    while((entry = e_list_next(&iter)) != NULL)
+    {
+        eBundleIndexEntry index = {
+            .path_offset = offset,
+            .path_len = entry->path.len,
+            .source_offset = offset + entry->path.len,
+            .source_len = entry->source.len
+        };
+
+        fwrite(&index, sizeof(index), 1, fp);
+
+        offset += entry->path.len + entry->source.len;
+    }
+
+    iter = e_list_iter(&entries);
+    while((entry = e_list_next(&iter)) != NULL)
+    {
+        fwrite(entry->path.ptr, 1, entry->path.len, fp);
+        fwrite(entry->source.ptr, 1, entry->source.len, fp);
+    }
+
+    bool ok = ferror(fp) == 0;
+    ok = fclose(fp) == 0 && ok;
+
+    e_arena_free(&arena);
+
+    return ok;
+}
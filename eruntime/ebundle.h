@@ -0,0 +1,64 @@
+#pragma once
+
+#include "estring.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define E_BUNDLE_MAGIC "EBUNDLE"
+#define E_BUNDLE_VERSION 1
+
+/**
+ * Layout of a bundle, all integers are in host byte order:
+ *   header
+ *   num_entries index entries, the first one is the main file
+ *   paths and sources
+ * Paths are relative to the directory of the main file and normalized
+*/
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t num_entries;
+} eBundleHeader;
+
+typedef struct
+{
+    uint32_t path_offset, path_len;
+    uint32_t source_offset, source_len;
+} eBundleIndexEntry;
+
+typedef struct
+{
+    eString path;
+    eString source;
+} eBundleEntry;
+
+/**
+ * A program and all files it imports, mapped into memory
+*/
+typedef struct
+{
+    void *data;
+    size_t size;
+
+    eBundleEntry *entries;
+    size_t num_entries;
+} eBundle;
+
+/**
+ * Maps a bundle, returns NULL if the file can't be read or isn't a valid bundle.
+ * is_bundle tells whether the file starts like a bundle, so that a corrupt one isn't mistaken for a script
+*/
+eBundle *e_bundle_open(const char *path, /* Nullable */ bool *is_bundle);
+
+void e_bundle_close(eBundle *bundle);
+
+/**
+ * Returns the source of a file in the bundle, the pointer is NULL if it isn't part of the bundle
+*/
+eString e_bundle_find(eBundle *bundle, eString path);
+
+/**
+ * Follows the imports of the main file and writes it and everything it imports into one file
+*/
+bool e_bundle_write(const char *main_path, const char *out_path);
@@ -0,0 +1,113 @@
+#include "eerror.h"
+#include <string.h>
+
+static const char *kind_names[] = {
+    [NO_ERROR] = "No error",
+    [LEXER_ERROR] = "Lexer error",
+    [PARSER_ERROR] = "Parser error",
+    [RUNTIME_ERROR] = "Runtime error",
+    [PROGRAM_EXIT] = "Exit"
+};
+
+// Every thread runs its own interpreters, so traps are per thread
+static _Thread_local eErrorTrap *current_trap = NULL;
+
+void e_error_trap_push(eErrorTrap *trap, const eSourceLocation *location, eErrorCleanup cleanup, void *data)
+{
+    trap->error = (eError) {.kind = NO_ERROR};
+    trap->location = location;
+    trap->cleanup = cleanup;
+    trap->data = data;
+    trap->prev = current_trap;
+
+    current_trap = trap;
+}
+
+void e_error_trap_pop(eErrorTrap *trap)
+{
+    current_trap = trap->prev;
+}
+
+_Noreturn void e_error_throw(eErrorKind kind, const char *message, size_t line)
+{
+    eError error = {
+        .kind = kind,
+        .message = message,
+        .file = "",
+        .line = line,
+        .code = -1
+    };
+
+    const eSourceLocation *location = current_trap != NULL ? current_trap->location : NULL;
+    if(location != NULL)
+    {
+        size_t len = location->path.len < sizeof(error.file) - 1 ? location->path.len : sizeof(error.file) - 1;
+        memcpy(error.file, location->path.ptr, len);
+        error.file[len] = '\0';
+
+        if(line == 0)
+        {
+            error.line = location->line;
+        }
+    }
+
+    e_error_rethrow(&error);
+}
+
+_Noreturn void e_error_rethrow(const eError *error)
+{
+    if(current_trap == NULL)
+    {
+        if(error->kind == PROGRAM_EXIT)
+        {
+            exit(error->code);
+        }
+
+        e_error_print(error, stderr);
+
+        exit(-1);
+    }
+
+    eErrorTrap *trap = current_trap;
+    trap->error = *error;
+
+    if(trap->cleanup != NULL)
+    {
+        trap->cleanup(trap->data);
+    }
+
+    longjmp(trap->env, 1);
+}
+
+_Noreturn void e_error_exit(int code)
+{
+    eError error = {
+        .kind = PROGRAM_EXIT,
+        .message = "",
+        .file = "",
+        .line = 0,
+        .code = code
+    };
+
+    e_error_rethrow(&error);
+}
+
+void e_error_format(const eError *error, char *buffer, size_t size)
+{
+    if(error->file[0] != '\0')
+    {
+        snprintf(buffer, size, "%s in %s on line %zu: %s\n", kind_names[error->kind], error->file, error->line, error->message);
+    }
+    else
+    {
+        snprintf(buffer, size, "%s on line %zu: %s\n", kind_names[error->kind], error->line, error->message);
+    }
+}
+
+void e_error_print(const eError *error, FILE *fp)
+{
+    char buffer[PATH_MAX + 256];
+    e_error_format(error, buffer, sizeof(buffer));
+
+    fputs(buffer, fp);
+}
@@ -1,15 +1,99 @@
 #pragma once
 
+#include "estring.h"
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <setjmp.h>
+#include <limits.h>
 
-#define LEXER_ERROR "Lexer error"
-#define PARSER_ERROR "Parser error"
-#define RUNTIME_ERROR "Runtime error"
+typedef enum
+{
+    NO_ERROR,
+
+    LEXER_ERROR,
+    PARSER_ERROR,
+    RUNTIME_ERROR,
+
+    PROGRAM_EXIT // Not a failure, the program called exit
+} eErrorKind;
+
+typedef struct
+{
+    eErrorKind kind;
+
+    const char *message;
+
+    char file[PATH_MAX]; // Empty if unknown
+    size_t line; // 0 if unknown
+
+    int code; // Exit code of PROGRAM_EXIT
+} eError;
+
+/**
+ * The statement that is currently executed, used for errors that don't know their own line
+*/
+typedef struct
+{
+    eString path;
+
+    size_t line;
+} eSourceLocation;
+
+typedef struct eerrortrap eErrorTrap;
+
+typedef void(* eErrorCleanup)(void *data);
+
+/**
+ * Catches errors thrown on the same thread while it is pushed.
+ * Pushed by the entry points of the interpreter, errors are thrown back to the innermost trap with longjmp
+*/
+struct eerrortrap
+{
+    jmp_buf env;
+
+    eError error; // NO_ERROR until something has been thrown
+
+    const eSourceLocation *location; // Nullable
+
+    // Called before jumping, while the stack frames of the interrupted code still exist
+    eErrorCleanup cleanup; // Nullable
+    void *data;
+
+    eErrorTrap *prev;
+};
+
+/**
+ * Has to be followed by setjmp(trap->env) in the same function
+*/
+void e_error_trap_push(eErrorTrap *trap, /* Nullable */ const eSourceLocation *location, /* Nullable */ eErrorCleanup cleanup, void *data);
+
+void e_error_trap_pop(eErrorTrap *trap);
+
+/**
+ * Jumps to the innermost trap, prints the error and exits the process if there is none.
+ * A line of 0 is replaced with the line of the current statement
+*/
+_Noreturn void e_error_throw(eErrorKind kind, const char *message, size_t line);
+
+/**
+ * Passes an error that has been caught on to the next trap
+*/
+_Noreturn void e_error_rethrow(const eError *error);
+
+/**
+ * Ends the program with an exit code, exits the process if there is no trap
+*/
+_Noreturn void e_error_exit(int code);
+
+/**
+ * Writes the message printed for an error into the buffer, truncated to its size
+*/
+void e_error_format(const eError *error, char *buffer, size_t size);
+
+void e_error_print(const eError *error, FILE *fp);
 
 #define THROW_ERROR(_type, _msg, _line) \
     { \
-    fprintf(stderr, _type " on line %ld: " _msg "\n", _line); \
-    exit(-1); \
+    e_error_throw(_type, _msg, _line); \
     }
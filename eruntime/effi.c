@@ -1,9 +1,15 @@
 #include "effi.h"
+#include "evm.h"
 #include "eerror.h"
 #include <dlfcn.h>
+#include <dirent.h>
 #include <string.h>
 
-typedef eFunctionDef *(* eModuleInitializer)(size_t *num_functions);
+#define DEFAULT_SEARCH_PATH "/.e"
+#define MAX_BUILTINS 16
+
+static eModuleInitializer builtins[MAX_BUILTINS];
+static size_t num_builtins = 0;
 
 char *c_str(eArena *arena, eString str)
 {
@@ -14,45 +20,367 @@ char *c_str(eArena *arena, eString str)
     return tmp;
 }
 
-// TODO: make this cross-platform
-eResult e_ffi_call(eString name, eString lib, eArena *arena, eScope *scope, eStack *arguments)
+static void registry_insert(eNativeRegistry *registry, eFunctionDef *function, uint32_t hash)
+{
+    size_t i = hash & (registry->size - 1);
+    while(registry->hashes[i] != 0)
+    {
+        i = (i + 1) & (registry->size - 1);
+    }
+
+    registry->entries[i] = function;
+    registry->hashes[i] = hash;
+    registry->len++;
+}
+
+static void registry_grow(eNativeRegistry *registry)
+{
+    eFunctionDef **entries = registry->entries;
+    uint32_t *hashes = registry->hashes;
+    size_t size = registry->size;
+
+    registry->size = size == 0 ? 64 : size * 2;
+    registry->len = 0;
+    registry->entries = malloc(registry->size * sizeof(eFunctionDef *));
+    registry->hashes = calloc(registry->size, sizeof(uint32_t));
+    if(!registry->entries || !registry->hashes)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to grow native function registry", 0l);
+    }
+
+    for(size_t i = 0; i < size; i++)
+    {
+        if(hashes[i] != 0)
+        {
+            registry_insert(registry, entries[i], hashes[i]);
+        }
+    }
+
+    free(entries);
+    free(hashes);
+}
+
+void e_ffi_add_builtin(eModuleInitializer initializer)
+{
+    if(num_builtins >= MAX_BUILTINS)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "too many builtin modules", 0l);
+    }
+
+    builtins[num_builtins++] = initializer;
+}
+
+eNativeRegistry *e_ffi_registry_new(void)
+{
+    eNativeRegistry *registry = calloc(1, sizeof(eNativeRegistry));
+    if(!registry)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to allocate native function registry", 0l);
+    }
+
+    // Builtins are registered first so that they can't be replaced by libraries on the search path
+    for(size_t i = 0; i < num_builtins; i++)
+    {
+        size_t num_functions = 0;
+        eFunctionDef *fun_table = builtins[i](&num_functions);
+
+        e_ffi_register(registry, fun_table, num_functions);
+    }
+
+    return registry;
+}
+
+void e_ffi_registry_free(eNativeRegistry *registry)
 {
-    eArena tmp = e_arena_new(32);
-    char *path = c_str(&tmp, lib);
+    for(size_t i = 0; i < registry->num_libraries; i++)
+    {
+        dlclose(registry->libraries[i]);
+    }
+
+    free(registry->libraries);
+    free(registry->entries);
+    free(registry->hashes);
+    free(registry);
+}
+
+void e_ffi_register(eNativeRegistry *registry, eFunctionDef *table, size_t num_functions)
+{
+    for(size_t i = 0; i < num_functions; i++)
+    {
+        if(e_ffi_lookup(registry, table[i].name) != NULL)
+        {
+            continue;
+        }
+
+        // Keep the load factor below one half
+        if((registry->len + 1) * 2 > registry->size)
+        {
+            registry_grow(registry);
+        }
 
+        registry_insert(registry, &table[i], e_string_hash(table[i].name));
+    }
+}
+
+// TODO: make this cross-platform
+bool e_ffi_load_library(eNativeRegistry *registry, const char *path)
+{
     void *dl = dlopen(path, RTLD_NOW);
     if(!dl)
     {
-        THROW_ERROR(RUNTIME_ERROR, "failed to open library\n", 0l);
+        return false;
+    }
+
+    for(size_t i = 0; i < registry->num_libraries; i++)
+    {
+        if(registry->libraries[i] == dl)
+        {
+            // Already loaded, dlopen only increased the reference count
+            dlclose(dl);
+
+            return true;
+        }
     }
 
     eModuleInitializer initializer = dlsym(dl, "e_mod_init");
     if(!initializer)
     {
-        THROW_ERROR(RUNTIME_ERROR, "failed to retrieve module init function\n", 0l);
+        // Not an elang module
+        dlclose(dl);
+
+        return false;
     }
 
+    void **libraries = realloc(registry->libraries, (registry->num_libraries + 1) * sizeof(void *));
+    if(!libraries)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to register library", 0l);
+    }
+
+    registry->libraries = libraries;
+    registry->libraries[registry->num_libraries++] = dl;
+
     size_t num_functions = 0;
     eFunctionDef *fun_table = initializer(&num_functions);
 
-    for(size_t i = 0; i < num_functions; i++)
+    e_ffi_register(registry, fun_table, num_functions);
+
+    return true;
+}
+
+eFunctionDef *e_ffi_lookup(eNativeRegistry *registry, eString name)
+{
+    if(registry->size == 0)
     {
-        eFunctionDef current = fun_table[i];
+        return NULL;
+    }
+
+    uint32_t hash = e_string_hash(name);
 
-        if(e_string_compare(current.name, name))
+    size_t i = hash & (registry->size - 1);
+    while(registry->hashes[i] != 0)
+    {
+        if(registry->hashes[i] == hash && e_string_compare(registry->entries[i]->name, name))
         {
-            if(current.num_args != e_stack_len(arguments))
-            {
-                THROW_ERROR(RUNTIME_ERROR, "wrong amount of arguments provided\n", 0l);
-            }
+            return registry->entries[i];
+        }
+
+        i = (i + 1) & (registry->size - 1);
+    }
+
+    return NULL;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char **) a, *(char **) b);
+}
 
+static bool is_library(const char *name)
+{
+    size_t len = strlen(name);
+
+    return len > 3 && strcmp(name + len - 3, ".so") == 0;
+}
+
+static void load_directory(eNativeRegistry *registry, eArena *arena, eString directory)
+{
+    DIR *dir = opendir(c_str(arena, directory));
+    if(!dir)
+    {
+        return;
+    }
+
+    eList names = {0}; // char *
+
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL)
+    {
+        if(is_library(entry->d_name))
+        {
+            char *name = c_str(arena, (eString) {.ptr = entry->d_name, .len = strlen(entry->d_name)});
+            e_list_push(arena, &names, &name, sizeof(char *));
+        }
+    }
+
+    closedir(dir);
+
+    // Load in a fixed order so that the same library wins every time two of them export the same name
+    size_t num_names = e_list_len(&names);
+    char **sorted = e_arena_alloc(arena, num_names * sizeof(char *));
+    for(size_t i = 0; i < num_names; i++)
+    {
+        sorted[i] = *E_LIST_AT(&names, i, char **);
+    }
+
+    qsort(sorted, num_names, sizeof(char *), compare_names);
+
+    for(size_t i = 0; i < num_names; i++)
+    {
+        eString file = {.ptr = sorted[i], .len = strlen(sorted[i])};
+        eString path = e_string_combine(arena, e_string_combine(arena, directory, (eString) {.ptr = "/", .len = 1}), file);
+
+        e_ffi_load_library(registry, c_str(arena, path));
+    }
+}
+
+void e_ffi_load_search_path(eNativeRegistry *registry)
+{
+    registry->search_path_loaded = true;
+
+    eArena tmp = e_arena_new(1024);
+
+    eString search_path;
+    char *env = getenv("ELANG_PATH");
+    if(env != NULL)
+    {
+        search_path = (eString) {.ptr = env, .len = strlen(env)};
+    }
+    else
+    {
+        char *user = getenv("HOME");
+        if(user == NULL)
+        {
             e_arena_free(&tmp);
 
-            return current.ptr(arena, scope, arguments);
+            return;
+        }
+
+        search_path = e_string_combine(&tmp, (eString) {.ptr = user, .len = strlen(user)}, (eString) {.ptr = DEFAULT_SEARCH_PATH, .len = strlen(DEFAULT_SEARCH_PATH)});
+    }
+
+    size_t start = 0;
+    for(size_t i = 0; i <= search_path.len; i++)
+    {
+        if(i == search_path.len || search_path.ptr[i] == ':')
+        {
+            if(i > start)
+            {
+                load_directory(registry, &tmp, e_string_slice(search_path, start, i - start));
+            }
+
+            start = i + 1;
         }
     }
 
     e_arena_free(&tmp);
+}
+
+eFunctionDef *e_ffi_resolve(eNativeRegistry *registry, eString name)
+{
+    eFunctionDef *function = e_ffi_lookup(registry, name);
+    if(function == NULL && !registry->search_path_loaded)
+    {
+        e_ffi_load_search_path(registry);
 
-    THROW_ERROR(RUNTIME_ERROR, "no functions found with that name\n", 0l);
-}
\ No newline at end of file
+        function = e_ffi_lookup(registry, name);
+    }
+
+    return function;
+}
+
+eFunctionDef *e_ffi_bind(eNativeRegistry *registry, eASTFunctionDecl *declaration)
+{
+    eFunctionDef *function = e_ffi_resolve(registry, declaration->identifier);
+    if(function == NULL)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "unresolved extern function", 0l);
+    }
+
+    size_t num_params = e_list_len(&declaration->params);
+    if(function->variadic ? num_params < function->num_args : function->num_args != num_params)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "extern declaration doesn't match the amount of arguments of the native function", 0l);
+    }
+
+    if(function->param_types != NULL)
+    {
+        eListIter iter = e_list_iter(&declaration->params);
+        for(size_t i = 0; i < function->num_args; i++)
+        {
+            eASTFunctionParam *param = e_list_next(&iter);
+            if(function->param_types[i] != VT_ANY && function->param_types[i] != param->value_type)
+            {
+                THROW_ERROR(RUNTIME_ERROR, "extern declaration doesn't match the parameter types of the native function", 0l);
+            }
+        }
+
+        if(function->return_type != VT_ANY && function->return_type != declaration->return_type)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "extern declaration doesn't match the return type of the native function", 0l);
+        }
+    }
+
+    return function;
+}
+
+eResult e_ffi_invoke(eFunctionDef *function, eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    if(function->int_unary != NULL)
+    {
+        return (eResult) {
+            .value = {.type = VT_INT, .integer = function->int_unary(args[0].integer)},
+            .is_void = false,
+            .is_return = false
+        };
+    }
+
+    if(function->int_binary != NULL)
+    {
+        return (eResult) {
+            .value = {.type = VT_INT, .integer = function->int_binary(args[0].integer, args[1].integer)},
+            .is_void = false,
+            .is_return = false
+        };
+    }
+
+    return function->ptr(arena, scope, args, num_args);
+}
+
+eResult e_ffi_call(eString name, eArena *arena, eScope *scope, const eValue *args, size_t num_args)
+{
+    eFunctionDef *function = e_ffi_resolve(scope->vm->natives, name);
+
+    if(function == NULL)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "no functions found with that name", 0l);
+    }
+
+    if(function->variadic ? num_args < function->num_args : function->num_args != num_args)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "wrong amount of arguments provided", 0l);
+    }
+
+    if(function->param_types != NULL)
+    {
+        for(size_t i = 0; i < function->num_args; i++)
+        {
+            if(function->param_types[i] != VT_ANY && function->param_types[i] != args[i].type)
+            {
+                THROW_ERROR(RUNTIME_ERROR, "type conflict", 0l);
+            }
+        }
+    }
+
+    return e_ffi_invoke(function, arena, scope, args, num_args);
+}
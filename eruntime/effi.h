@@ -2,15 +2,97 @@
 
 #include "einterpreter.h"
 
-typedef eResult(* eFunctionPtr)(eArena *arena, eScope *scope, eStack *arguments);
+typedef struct enativeregistry eNativeRegistry;
 
-typedef struct
+typedef eResult(* eFunctionPtr)(eArena *arena, eScope *scope, const eValue *args, size_t num_args);
+
+// Unboxed entry points for common signatures
+typedef int(* eIntUnaryPtr)(int a);
+typedef int(* eIntBinaryPtr)(int a, int b);
+
+struct efunctiondef
 {
     eString name;
 
-    eFunctionPtr ptr;
+    eFunctionPtr ptr; // NULL if an unboxed entry point is set
 
     size_t num_args;
-} eFunctionDef;
 
-eResult e_ffi_call(eString name, eString lib, eArena *arena, eScope *scope, eStack *arguments);
+    /**
+     * Arguments are checked against these types by the runtime, so typed functions don't need to validate them.
+     * NULL if the function checks its arguments itself
+    */
+    const eValueType *param_types;
+    eValueType return_type;
+
+    eIntUnaryPtr int_unary;
+    eIntBinaryPtr int_binary;
+
+    bool pure; // Calls with literal arguments may be evaluated once at load time, if that throws the call is left for run time
+
+    bool variadic; // Any amount of untyped arguments may follow the first num_args
+};
+
+typedef eFunctionDef *(* eModuleInitializer)(size_t *num_functions);
+
+/**
+ * Native functions of all loaded libraries, hashed by name
+*/
+struct enativeregistry
+{
+    eFunctionDef **entries;
+    uint32_t *hashes;
+    size_t len, size;
+
+    void **libraries; // Handles returned by dlopen
+    size_t num_libraries;
+
+    bool search_path_loaded;
+};
+
+/**
+ * Adds a module that is linked into the executable, every registry created afterwards starts with its functions.
+ * Has to be called before any interpreter is created
+*/
+void e_ffi_add_builtin(eModuleInitializer initializer);
+
+eNativeRegistry *e_ffi_registry_new(void);
+
+void e_ffi_registry_free(eNativeRegistry *registry);
+
+/**
+ * Adds a function table to the registry, functions that are already registered are kept
+*/
+void e_ffi_register(eNativeRegistry *registry, eFunctionDef *table, size_t num_functions);
+
+/**
+ * Opens a library once and registers its function table, returns false if the library couldn't be loaded
+*/
+bool e_ffi_load_library(eNativeRegistry *registry, const char *path);
+
+/**
+ * Loads every library in the directories of ELANG_PATH (colon separated, defaults to $HOME/.e)
+*/
+void e_ffi_load_search_path(eNativeRegistry *registry);
+
+/**
+ * Looks up a function, loads the search path the first time a name is missing
+*/
+eFunctionDef *e_ffi_resolve(eNativeRegistry *registry, eString name);
+
+/**
+ * Resolves an extern declaration, reports missing functions and mismatching signatures
+*/
+eFunctionDef *e_ffi_bind(eNativeRegistry *registry, eASTFunctionDecl *declaration);
+
+/**
+ * Returns NULL if no function with that name has been registered
+*/
+eFunctionDef *e_ffi_lookup(eNativeRegistry *registry, eString name);
+
+/**
+ * Calls a native function with arguments that have already been checked
+*/
+eResult e_ffi_invoke(eFunctionDef *function, eArena *arena, eScope *scope, const eValue *args, size_t num_args);
+
+eResult e_ffi_call(eString name, eArena *arena, eScope *scope, const eValue *args, size_t num_args);
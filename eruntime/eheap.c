@@ -0,0 +1,184 @@
+#include "eheap.h"
+#include "eerror.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void zct_push(eStringHeap *heap, eHeapString *string)
+{
+    if(heap->zct_len >= heap->zct_size)
+    {
+        heap->zct_size = heap->zct_size == 0 ? 64 : heap->zct_size * 2;
+        heap->zct = realloc(heap->zct, heap->zct_size * sizeof(eHeapString *));
+        if(!heap->zct)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "failed to grow string heap", 0l);
+        }
+    }
+
+    string->in_zct = true;
+    heap->zct[heap->zct_len++] = string;
+}
+
+static void string_free(eStringHeap *heap, eHeapString *string)
+{
+    if(string->prev != NULL)
+    {
+        string->prev->next = string->next;
+    }
+    else
+    {
+        heap->objects = string->next;
+    }
+
+    if(string->next != NULL)
+    {
+        string->next->prev = string->prev;
+    }
+
+    heap->live_bytes -= string->capacity;
+    heap->live_objects--;
+
+    if(heap->stats != NULL)
+    {
+        e_memory_release(heap->stats, string->capacity);
+    }
+
+    if(string->finalizer != NULL)
+    {
+        string->finalizer(string->external, string->len);
+    }
+
+    free(string);
+}
+
+eStringHeap *e_heap_new(eMemoryStats *stats)
+{
+    eStringHeap *heap = calloc(1, sizeof(eStringHeap));
+    if(!heap)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to allocate string heap", 0l);
+    }
+
+    heap->stats = stats;
+
+    return heap;
+}
+
+void e_heap_free(eStringHeap *heap)
+{
+    eHeapString *current = heap->objects;
+    while(current != NULL)
+    {
+        eHeapString *tmp = current->next;
+
+        if(heap->stats != NULL)
+        {
+            e_memory_release(heap->stats, current->capacity);
+        }
+
+        if(current->finalizer != NULL)
+        {
+            current->finalizer(current->external, current->len);
+        }
+
+        free(current);
+
+        current = tmp;
+    }
+
+    free(heap->zct);
+    free(heap);
+}
+
+eHeapString *e_heap_string_alloc(eStringHeap *heap, size_t len)
+{
+    eHeapString *string = e_heap_string_reserve(heap, len);
+    string->len = len;
+
+    return string;
+}
+
+eHeapString *e_heap_string_reserve(eStringHeap *heap, size_t capacity)
+{
+    if(heap->stats != NULL)
+    {
+        e_memory_acquire(heap->stats, capacity);
+
+        heap->stats->by_category[EMEM_STRINGS] += capacity;
+    }
+
+    eHeapString *string = malloc(sizeof(eHeapString) + capacity);
+    if(!string)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to allocate string", 0l);
+    }
+
+    string->refs = 0;
+    string->len = 0;
+    string->capacity = capacity;
+    string->in_zct = false;
+    string->external = NULL;
+    string->finalizer = NULL;
+
+    string->prev = NULL;
+    string->next = heap->objects;
+    if(heap->objects != NULL)
+    {
+        heap->objects->prev = string;
+    }
+    heap->objects = string;
+
+    heap->live_bytes += capacity;
+    heap->live_objects++;
+
+    zct_push(heap, string);
+
+    return string;
+}
+
+eHeapString *e_heap_string_external(eStringHeap *heap, char *data, size_t len, eHeapFinalizer finalizer)
+{
+    eHeapString *string = e_heap_string_reserve(heap, 0);
+    string->len = len;
+    string->external = data;
+    string->finalizer = finalizer;
+
+    return string;
+}
+
+void e_heap_retain(eHeapString *string)
+{
+    string->refs++;
+}
+
+void e_heap_release(eStringHeap *heap, eHeapString *string)
+{
+    if(--string->refs == 0 && !string->in_zct)
+    {
+        // Freeing is deferred since the value might still be used by the current statement
+        zct_push(heap, string);
+    }
+}
+
+size_t e_heap_mark(eStringHeap *heap)
+{
+    return heap->zct_len;
+}
+
+void e_heap_collect(eStringHeap *heap, size_t mark)
+{
+    for(size_t i = mark; i < heap->zct_len; i++)
+    {
+        eHeapString *string = heap->zct[i];
+        if(string->refs == 0)
+        {
+            string_free(heap, string);
+        }
+        else
+        {
+            string->in_zct = false;
+        }
+    }
+
+    heap->zct_len = mark;
+}
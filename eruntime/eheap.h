@@ -0,0 +1,77 @@
+#pragma once
+
+#include "estring.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct eheapstring eHeapString;
+
+typedef void(* eHeapFinalizer)(void *data, size_t len);
+
+/**
+ * A reference counted string living on the string heap.
+ * Strings that are not referenced by any variable are kept in the zero count table
+ * until the statement that created them has finished.
+*/
+struct eheapstring
+{
+    size_t refs;
+
+    size_t len, capacity;
+
+    bool in_zct;
+
+    eHeapString *prev, *next;
+
+    // Set for strings wrapping memory the heap doesn't own, data is empty in that case
+    char *external;
+    eHeapFinalizer finalizer;
+
+    char data[];
+};
+
+typedef struct
+{
+    eHeapString *objects;
+
+    eHeapString **zct; // Zero count table
+    size_t zct_len, zct_size;
+
+    size_t live_bytes, live_objects;
+
+    eMemoryStats *stats; // NULL if untracked
+} eStringHeap;
+
+eStringHeap *e_heap_new(/* Nullable */ eMemoryStats *stats);
+
+void e_heap_free(eStringHeap *heap);
+
+/**
+ * Allocates a new string with a reference count of zero
+*/
+eHeapString *e_heap_string_alloc(eStringHeap *heap, size_t len);
+
+/**
+ * Allocates an empty string with room for capacity bytes that can be appended in place
+*/
+eHeapString *e_heap_string_reserve(eStringHeap *heap, size_t capacity);
+
+/**
+ * Wraps memory that isn't owned by the heap, such as a mapped file.
+ * The finalizer is called once the string isn't referenced anymore
+*/
+eHeapString *e_heap_string_external(eStringHeap *heap, char *data, size_t len, eHeapFinalizer finalizer);
+
+void e_heap_retain(eHeapString *string);
+
+void e_heap_release(eStringHeap *heap, eHeapString *string);
+
+/**
+ * Returns the current top of the zero count table
+*/
+size_t e_heap_mark(eStringHeap *heap);
+
+/**
+ * Frees all unreferenced strings that were added to the zero count table after the mark
+*/
+void e_heap_collect(eStringHeap *heap, size_t mark);
@@ -1,52 +1,626 @@
 #include "einterpreter.h"
 #include "eerror.h"
 #include "eio.h"
-#include "effi.h"
+#include "evm.h"
+#include "eoptimize.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
+#include <ctype.h>
+
+static void arguments_push(eArgumentBuffer *buffer, eValue value)
+{
+    if(buffer->len >= buffer->size)
+    {
+        eValue *items = malloc(buffer->size * 2 * sizeof(eValue));
+        if(!items)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "failed to grow argument buffer", 0l);
+        }
+
+        memcpy(items, buffer->items, buffer->len * sizeof(eValue));
+        if(buffer->items != buffer->inline_items)
+        {
+            free(buffer->items);
+        }
+
+        buffer->items = items;
+        buffer->size *= 2;
+    }
+
+    buffer->items[buffer->len++] = value;
+}
+
+static void arguments_free(eArgumentBuffer *buffer)
+{
+    if(buffer->items != buffer->inline_items)
+    {
+        free(buffer->items);
+    }
+}
 
 bool e_exec_file(eString path, eScope *scope, eFileState *file)
 {
+    eMemoryCategory category = e_arena_set_category(&scope->allocator, EMEM_SOURCE);
     eString txt = e_read_file(&scope->allocator, path);
+    e_arena_set_category(&scope->allocator, category);
     if(!txt.ptr)
     {
         return false;
     }
 
-    eListNode *tokens = e_lex(&scope->allocator, txt);
+    e_exec_source(txt, scope, file);
+
+    return true;
+}
+
+/**
+ * Tokens and the AST go into the given arena, folded literals into the scope since values can outlive the AST.
+ * The source is only lexed if no tokens are given. Unless it is transient, the source lives as long as the scope,
+ * so string literals are interned without copying them
+*/
+static void exec_source(eString txt, /* Nullable */ const eList *lexed, size_t first_line, bool transient, eArena *arena, eScope *scope, eFileState *file)
+{
+    eSourceLocation *location = &scope->vm->location;
+    eSourceLocation outer = *location;
+    *location = (eSourceLocation) {.path = file->path, .line = 0};
+
+    eMemoryCategory category = e_arena_set_category(arena, EMEM_TOKENS);
+    eList tokens = lexed != NULL ? *lexed : e_lex_from(arena, txt, first_line);
 
-    eParser parser = e_parser_new(tokens, txt);
+    eParser parser = e_parser_new(tokens, txt, scope->vm->pool, transient ? NULL : scope);
 
-    eASTNode *expr = e_parse_statement(&scope->allocator, &parser);
+    e_arena_set_category(arena, EMEM_AST);
+    eASTNode *expr = e_parse_statement(arena, &parser);
+    location->line = expr->line;
+    e_optimize(&scope->allocator, expr, scope);
+    e_arena_set_category(arena, category);
 
     while(expr->tag != AST_EOF)
     {
+        size_t mark = e_heap_mark(scope->vm->heap);
+
         eResult value = e_evaluate(&scope->allocator, expr, scope, file);
 
-        expr = e_parse_statement(&scope->allocator, &parser);
+        e_heap_collect(scope->vm->heap, mark);
+
+        category = e_arena_set_category(arena, EMEM_AST);
+        expr = e_parse_statement(arena, &parser);
+        location->line = expr->line;
+        e_optimize(&scope->allocator, expr, scope);
+        e_arena_set_category(arena, category);
+    }
+
+    // Imported files are executed in the middle of a statement of the importing file
+    *location = outer;
+}
+
+void e_exec_source(eString txt, eScope *scope, eFileState *file)
+{
+    exec_source(txt, NULL, 1, false, &scope->allocator, scope, file);
+}
+
+void e_exec_tokens(eList tokens, eString txt, eScope *scope, eFileState *file)
+{
+    exec_source(txt, &tokens, 1, false, &scope->allocator, scope, file);
+}
+
+typedef struct
+{
+    int fd;
+
+    char *buffer;
+    size_t start, end, size;
+
+    bool at_end;
+
+    size_t line; // Number of the line that was returned last
+} LineReader;
+
+/**
+ * Returns the next line including its newline, the pointer is NULL at the end of the input.
+ * The output is flushed before blocking, so that results show up while the producer is still writing
+*/
+static eString next_line(LineReader *reader, eOutput *output)
+{
+    while(true)
+    {
+        char *newline = memchr(reader->buffer + reader->start, '\n', reader->end - reader->start);
+        if(newline != NULL || (reader->at_end && reader->start < reader->end))
+        {
+            size_t len = newline != NULL ? (size_t) (newline + 1 - (reader->buffer + reader->start)) : reader->end - reader->start;
+
+            eString line = {.ptr = reader->buffer + reader->start, .len = len};
+            reader->start += len;
+            reader->line++;
+
+            return line;
+        }
+
+        if(reader->at_end)
+        {
+            return (eString) {.ptr = NULL, .len = 0};
+        }
+
+        // Keep the partial line and make room for more input
+        memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+
+        if(reader->end == reader->size)
+        {
+            reader->size *= 2;
+            reader->buffer = realloc(reader->buffer, reader->size);
+            if(!reader->buffer)
+            {
+                THROW_ERROR(RUNTIME_ERROR, "failed to grow input buffer", 0l);
+            }
+        }
+
+        e_output_flush(output);
+
+        ssize_t n = read(reader->fd, reader->buffer + reader->end, reader->size - reader->end);
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(n <= 0)
+        {
+            reader->at_end = true;
+        }
+        else
+        {
+            reader->end += n;
+        }
+    }
+}
+
+/**
+ * The source of the top level statements that haven't been executed yet
+*/
+typedef struct
+{
+    char *text;
+    size_t len, size;
+
+    size_t first_line; // Line of the stream the chunk starts on, so that errors point into the stream
+
+    long depth; // Brackets and braces left open
+
+    eArena scratch; // Tokens and AST of the chunk that is executed, empty otherwise
+} Chunk;
+
+/**
+ * Where the statements of a chunk end relative to the line that has been appended last
+*/
+typedef enum
+{
+    SPLIT_NONE, // A statement continues on the line, or needs more input
+    SPLIT_BEFORE_LINE, // Every statement before the line is complete and the line starts a new one
+    SPLIT_FAILED // A syntax error that no further input can fix
+} eChunkSplit;
+
+static bool is_blank(eString line)
+{
+    for(size_t i = 0; i < line.len; i++)
+    {
+        if(!isspace(line.ptr[i]))
+        {
+            return false;
+        }
     }
 
     return true;
 }
 
+static void chunk_append(Chunk *chunk, eString line)
+{
+    if(chunk->len + line.len > chunk->size)
+    {
+        while(chunk->len + line.len > chunk->size)
+        {
+            chunk->size = chunk->size == 0 ? 256 : chunk->size * 2;
+        }
+
+        chunk->text = realloc(chunk->text, chunk->size);
+        if(!chunk->text)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "failed to grow input buffer", 0l);
+        }
+    }
+
+    memcpy(chunk->text + chunk->len, line.ptr, line.len);
+    chunk->len += line.len;
+}
+
+/**
+ * Counts the brackets and braces a line opens, returns false if it can't be lexed.
+ * Tokens never span lines, so the line can be lexed on its own
+*/
+static bool line_depth(eString line, long *depth)
+{
+    eArena arena = e_arena_new(1024);
+
+    eErrorTrap trap;
+    e_error_trap_push(&trap, NULL, NULL, NULL);
+    if(setjmp(trap.env) == 0)
+    {
+        eList tokens = e_lex(&arena, line);
+        eListIter iter = e_list_iter(&tokens);
+
+        *depth = 0;
+
+        eToken *tk;
+        while((tk = e_list_next(&iter)) != NULL)
+        {
+            if(tk->tag == ETK_L_PAREN || tk->tag == ETK_L_CURLY_BRACE)
+            {
+                (*depth)++;
+            }
+            else if(tk->tag == ETK_R_PAREN || tk->tag == ETK_R_CURLY_BRACE)
+            {
+                (*depth)--;
+            }
+        }
+    }
+    e_error_trap_pop(&trap);
+
+    e_arena_free(&arena);
+
+    return trap.error.kind == NO_ERROR;
+}
+
+static void parse_until(eArena *arena, eParser *parser, size_t offset)
+{
+    while(true)
+    {
+        eToken *tk = E_LIST_AT(&parser->tokens, parser->index, eToken *);
+        if(tk->tag == ETK_EOF || tk->start >= offset)
+        {
+            return;
+        }
+
+        e_parse_statement(arena, parser);
+    }
+}
+
+/**
+ * Lexes and parses the whole chunk the same way a file is, so a statement is only complete
+ * once the next line doesn't continue it. Nothing is executed and no string is interned
+*/
+static eChunkSplit chunk_split(const Chunk *chunk, size_t line_start)
+{
+    eString txt = {.ptr = chunk->text, .len = chunk->len};
+
+    eArena arena = e_arena_new(4096);
+    eParser parser = {0};
+
+    eErrorTrap trap;
+    e_error_trap_push(&trap, NULL, NULL, NULL);
+    if(setjmp(trap.env) == 0)
+    {
+        parser = e_parser_new(e_lex_from(&arena, txt, chunk->first_line), txt, NULL, NULL);
+
+        parse_until(&arena, &parser, line_start);
+    }
+    e_error_trap_pop(&trap);
+
+    eChunkSplit split = SPLIT_NONE;
+    if(trap.error.kind != NO_ERROR)
+    {
+        // Running out of tokens only means that the rest hasn't been read yet, the last token is EOF
+        bool at_end = parser.tokens.len > 0 && parser.index + 1 >= parser.tokens.len;
+
+        split = at_end ? SPLIT_NONE : SPLIT_FAILED;
+    }
+    else if(E_LIST_AT(&parser.tokens, parser.index, eToken *)->start == line_start)
+    {
+        split = SPLIT_BEFORE_LINE;
+    }
+
+    e_arena_free(&arena);
+
+    return split;
+}
+
+static bool has_token(eList *tokens, eTokenTag tag)
+{
+    eListIter iter = e_list_iter(tokens);
+
+    eToken *tk;
+    while((tk = e_list_next(&iter)) != NULL)
+    {
+        if(tk->tag == tag)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Executes the first len bytes of the chunk and removes them
+*/
+static void chunk_exec(Chunk *chunk, size_t len, eScope *scope, eFileState *file)
+{
+    eString txt = {.ptr = chunk->text, .len = len};
+
+    chunk->scratch = e_arena_new_tracked(4096, &scope->vm->stats);
+
+    eMemoryCategory category = e_arena_set_category(&chunk->scratch, EMEM_TOKENS);
+    eList tokens = e_lex_from(&chunk->scratch, txt, chunk->first_line);
+    e_arena_set_category(&chunk->scratch, category);
+
+    bool binds_names = has_token(&tokens, ETK_KEYWORD_VAR) || has_token(&tokens, ETK_KEYWORD_CONST)
+        || has_token(&tokens, ETK_KEYWORD_FUN) || has_token(&tokens, ETK_KEYWORD_IMPORT);
+    if(binds_names)
+    {
+        // Names of variables, functions and imports point into the text, so it is kept for as long as the scope.
+        // Other chunks are done with the text once they have been executed, their string literals are copied into the pool
+        category = e_arena_set_category(&scope->allocator, EMEM_SOURCE);
+        txt = e_string_alloc(&scope->allocator, len);
+        memcpy(txt.ptr, chunk->text, len);
+        e_arena_set_category(&scope->allocator, category);
+    }
+
+    if(has_token(&tokens, ETK_KEYWORD_FUN))
+    {
+        // The tokens and AST have to be kept, function bodies are parsed from them later
+        exec_source(txt, NULL, chunk->first_line, false, &scope->allocator, scope, file);
+    }
+    else
+    {
+        // Tokens and the AST of a statement are not needed anymore once it has been executed
+        exec_source(txt, &tokens, chunk->first_line, !binds_names, &chunk->scratch, scope, file);
+    }
+
+    e_arena_free(&chunk->scratch);
+    chunk->scratch = (eArena) {0};
+
+    chunk->len -= len;
+    memmove(chunk->text, chunk->text + len, chunk->len);
+}
+
+static void read_stream(LineReader *reader, Chunk *chunk, eScope *scope, eFileState *file)
+{
+    eString line;
+    while((line = next_line(reader, scope->vm->output)).ptr != NULL)
+    {
+        if(is_blank(line))
+        {
+            // Kept so that the lines of the statement stay right
+            if(chunk->len > 0)
+            {
+                chunk_append(chunk, line);
+            }
+
+            continue;
+        }
+
+        long depth = 0;
+        bool lexed = line_depth(line, &depth);
+
+        if(chunk->len == 0)
+        {
+            chunk->first_line = reader->line;
+            chunk->depth = depth;
+            chunk_append(chunk, line);
+
+            continue;
+        }
+
+        size_t line_start = chunk->len;
+        chunk_append(chunk, line);
+
+        if(lexed && chunk->depth > 0)
+        {
+            // The statement that left a bracket open continues on this line, no need to parse it yet
+            chunk->depth += depth;
+
+            continue;
+        }
+
+        chunk->depth += depth;
+
+        switch(chunk_split(chunk, line_start))
+        {
+        case SPLIT_BEFORE_LINE:
+            chunk_exec(chunk, line_start, scope, file);
+            chunk->first_line = reader->line;
+            chunk->depth = depth;
+
+            break;
+
+        case SPLIT_FAILED:
+            // Raises the error, after running the statements in front of it
+            chunk_exec(chunk, chunk->len, scope, file);
+            chunk->depth = 0;
+
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if(chunk->len > 0)
+    {
+        chunk_exec(chunk, chunk->len, scope, file);
+    }
+}
+
+void e_exec_stream(int fd, eScope *scope, eFileState *file)
+{
+    LineReader reader = {
+        .fd = fd,
+        .buffer = malloc(4096),
+        .start = 0,
+        .end = 0,
+        .size = 4096,
+        .at_end = false,
+        .line = 0
+    };
+    if(!reader.buffer)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to allocate input buffer", 0l);
+    }
+
+    Chunk chunk = {0};
+
+    // The buffers aren't owned by an arena, so they are freed before an error is passed on
+    eVMCheckpoint checkpoint = e_vm_checkpoint(scope->vm);
+
+    eErrorTrap trap;
+    e_error_trap_push(&trap, &scope->vm->location, e_vm_unwind, &checkpoint);
+    if(setjmp(trap.env) == 0)
+    {
+        read_stream(&reader, &chunk, scope, file);
+    }
+    e_error_trap_pop(&trap);
+
+    e_arena_free(&chunk.scratch);
+    free(chunk.text);
+    free(reader.buffer);
+
+    if(trap.error.kind != NO_ERROR)
+    {
+        e_error_rethrow(&trap.error);
+    }
+}
+
 eScope e_scope_new(eScope *parent, eASTFunctionDecl *function)
 {
     return (eScope) {
-        .allocator = e_arena_new(2048),
+        .allocator = e_arena_new_tracked(2048, &parent->vm->stats),
+        .vm = parent->vm,
         .parent = parent,
-        .functions = NULL,
-        .variables = NULL,
-        .function = function
+        .functions = {0},
+        .variables = {0},
+        .imports = {0},
+        .function = function,
+        .prev_frame = NULL
+    };
+}
+
+eScope e_scope_new_root(eVM *vm)
+{
+    return (eScope) {
+        .allocator = e_arena_new_tracked(2048, &vm->stats),
+        .vm = vm,
+        .parent = NULL,
+        .functions = {0},
+        .variables = {0},
+        .imports = {0},
+        .function = NULL,
+        .prev_frame = NULL
     };
 }
 
 void e_scope_free(eScope *scope)
 {
+    eListIter iter = e_list_iter(&scope->variables);
+    eVariable *var;
+    while((var = e_list_next(&iter)) != NULL)
+    {
+        e_value_release(scope, var->value);
+    }
+
+    if(scope->parent == NULL)
+    {
+        // String literals of the main program and of modules point into a source that goes away with the scope
+        e_string_pool_release(scope->vm->pool, scope);
+    }
+
     e_arena_free(&scope->allocator);
 }
 
+eValue e_value_new_string(eScope *scope, eString contents)
+{
+    eHeapString *owner = e_heap_string_alloc(scope->vm->heap, contents.len);
+    memcpy(owner->data, contents.ptr, contents.len);
+
+    return (eValue) {
+        .type = VT_STRING,
+        .string = {
+            .ptr = owner->data,
+            .len = contents.len
+        },
+        .owner = owner
+    };
+}
+
+eValue e_value_concat(eScope *scope, eValue a, eValue b)
+{
+    if(b.string.len == 0)
+    {
+        return a;
+    }
+
+    if(a.string.len == 0)
+    {
+        return b;
+    }
+
+    size_t len = a.string.len + b.string.len;
+
+    eHeapString *owner = a.owner;
+    if(owner != NULL &&
+       owner->external == NULL &&
+       a.string.ptr + a.string.len == owner->data + owner->len &&
+       len <= owner->capacity - (a.string.ptr - owner->data))
+    {
+        // Nothing has been appended to this buffer after a, so it can be extended without copying a
+        memcpy(owner->data + owner->len, b.string.ptr, b.string.len);
+        owner->len += b.string.len;
+
+        return (eValue) {
+            .type = VT_STRING,
+            .string = {
+                .ptr = a.string.ptr,
+                .len = len
+            },
+            .owner = owner
+        };
+    }
+
+    // Strings that are built up by repeated concatenation get room to grow geometrically
+    size_t capacity = owner != NULL ? len * 2 : len;
+
+    owner = e_heap_string_reserve(scope->vm->heap, capacity);
+    memcpy(owner->data, a.string.ptr, a.string.len);
+    memcpy(owner->data + a.string.len, b.string.ptr, b.string.len);
+    owner->len = len;
+
+    return (eValue) {
+        .type = VT_STRING,
+        .string = {
+            .ptr = owner->data,
+            .len = len
+        },
+        .owner = owner
+    };
+}
+
+void e_value_retain(eValue value)
+{
+    if(value.type == VT_STRING && value.owner != NULL)
+    {
+        e_heap_retain(value.owner);
+    }
+}
+
+void e_value_release(eScope *scope, eValue value)
+{
+    if(value.type == VT_STRING && value.owner != NULL)
+    {
+        e_heap_release(scope->vm->heap, value.owner);
+    }
+}
+
 static bool is_equal(eValue a, eValue b)
 {
     if(a.type != b.type)
@@ -63,7 +637,22 @@ static bool is_equal(eValue a, eValue b)
         return a.boolean == b.boolean;
 
     case VT_STRING:
-        return e_string_compare(a.string, b.string);
+        if(a.string.len != b.string.len)
+        {
+            return false;
+        }
+
+        if(a.string.ptr == b.string.ptr)
+        {
+            return true;
+        }
+
+        if(a.hash != 0 && b.hash != 0 && a.hash != b.hash)
+        {
+            return false;
+        }
+
+        return memcmp(a.string.ptr, b.string.ptr, a.string.len) == 0;
 
     default:
         THROW_ERROR(RUNTIME_ERROR, "invalid comparison", 0l);
@@ -104,6 +693,68 @@ static bool is_greater(eValue a, eValue b)
     }
 }
 
+static eImport *find_import(eString identifier, eScope *scope)
+{
+    eScope *current = scope;
+    while(current != NULL)
+    {
+        eListIter iter = e_list_iter(&current->imports);
+        eImport *import;
+        while((import = e_list_next(&iter)) != NULL)
+        {
+            if(e_string_compare(import->identifier, identifier))
+            {
+                return import;
+            }
+        }
+
+        current = current->parent;
+    }
+
+    return NULL;
+}
+
+static eMember *resolve_member(eASTNode *node, eScope *scope);
+
+/**
+ * Resolves the base of a member expression, which is either an import or a module imported by another module
+*/
+static eModule *resolve_module(eASTNode *node, eScope *scope)
+{
+    if(node->tag == AST_IDENTIFIER)
+    {
+        eImport *import = find_import(node->identifier, scope);
+        if(import == NULL)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "unknown module", 0l);
+        }
+
+        // Lazily imported modules are loaded on first use
+        return e_module_load(import->module);
+    }
+
+    eMember *member = resolve_member(node, scope);
+    if(member->kind != MEMBER_MODULE)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "member is not a module", 0l);
+    }
+
+    return e_module_load(member->module);
+}
+
+static eMember *resolve_member(eASTNode *node, eScope *scope)
+{
+    eModule *module = resolve_module(node->member.base, scope);
+
+    eMember *member = e_module_member(module, node->member.identifier, node->member.hash);
+    if(member == NULL)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "unknown member", 0l);
+    }
+
+    return member;
+}
+
 eResult e_evaluate(eArena *arena, eASTNode *node, eScope *scope, eFileState *file)
 {
     switch(node->tag)
@@ -123,7 +774,8 @@ eResult e_evaluate(eArena *arena, eASTNode *node, eScope *scope, eFileState *fil
         return (eResult) {
             .value = {
                 .type = VT_STRING,
-                .string = node->string_literal.value
+                .string = node->string_literal.value,
+                .hash = node->string_literal.hash
             },
             .is_void = false,
             .is_return = false
@@ -142,7 +794,25 @@ eResult e_evaluate(eArena *arena, eASTNode *node, eScope *scope, eFileState *fil
 
     case AST_ARITHMETIC: {
         eResult lhs = e_evaluate(arena, node->arithmetic.lhs, scope, file);
+
+        // Keep the left side alive while the right side is evaluated
+        e_value_retain(lhs.value);
         eResult rhs = e_evaluate(arena, node->arithmetic.rhs, scope, file);
+        e_value_release(scope, lhs.value);
+
+        if(lhs.value.type == VT_STRING || rhs.value.type == VT_STRING)
+        {
+            if(lhs.value.type != rhs.value.type || node->arithmetic.op != OP_ADD)
+            {
+                THROW_ERROR(RUNTIME_ERROR, "strings can only be added to strings", 0l);
+            }
+
+            return (eResult) {
+                .value = e_value_concat(scope, lhs.value, rhs.value),
+                .is_void = false,
+                .is_return = false
+            };
+        }
 
         switch(node->arithmetic.op)
         {
@@ -220,26 +890,64 @@ eResult e_evaluate(eArena *arena, eASTNode *node, eScope *scope, eFileState *fil
     }
 
     case AST_FUNCTION_CALL: {
-        eStack args = e_stack_new(arena, 128, sizeof(eValue));
-
-        eListNode *current = node->function_call.arguments;
-        while(current != NULL)
+        eArgumentBuffer args;
+        args.items = args.inline_items;
+        args.len = 0;
+        args.size = INLINE_ARGUMENTS;
+        args.prev = scope->vm->arguments;
+        scope->vm->arguments = &args;
+
+        eListIter iter = e_list_iter(&node->function_call.arguments);
+        eASTNode *arg;
+        while((arg = e_list_next(&iter)) != NULL)
         {
-            eResult result = e_evaluate(arena, current->data, scope, file);
+            eResult result = e_evaluate(arena, arg, scope, file);
             if(result.is_void)
             {
                 THROW_ERROR(RUNTIME_ERROR, "cannot accept void as argument", 0l);
             }
 
-            e_stack_push(arena, &args, &result.value);
+            e_value_retain(result.value);
+            arguments_push(&args, result.value);
+        }
+
+        eASTNode *base = node->function_call.base;
+
+        eFunctionCall call = {
+            .args = args.items,
+            .num_args = args.len,
+            .identifier = base->tag == AST_MEMBER ? base->member.identifier : base->identifier
+        };
+
+        eResult result;
+        if(base->tag == AST_MEMBER)
+        {
+            eModule *module = resolve_module(base->member.base, scope);
+
+            eMember *member = e_module_member(module, base->member.identifier, base->member.hash);
+            if(member == NULL || member->kind != MEMBER_FUNCTION)
+            {
+                THROW_ERROR(RUNTIME_ERROR, "unknown function in module", 0l);
+            }
 
-            current = current->next;
+            // Functions of a module only see the names of the module
+            result = e_call_function(arena, member->function, call, &module->scope, &module->file);
+        }
+        else
+        {
+            result = e_call(arena, call, scope, file);
+        }
+
+        scope->vm->arguments = args.prev;
+
+        for(size_t i = 0; i < args.len; i++)
+        {
+            e_value_release(scope, args.items[i]);
         }
 
-        return e_call(arena, (eFunctionCall) {
-            .args = args,
-            .identifier = node->function_call.base->identifier
-        }, scope, file);
+        arguments_free(&args);
+
+        return result;
     }
 
     case AST_IF_STATEMENT: {
@@ -248,11 +956,11 @@ eResult e_evaluate(eArena *arena, eASTNode *node, eScope *scope, eFileState *fil
         eResult result = {0};
         if(condition.value.boolean)
         {
-            result = e_evaluate_body(arena, node->if_statement.body, scope, file);
+            result = e_evaluate_body(arena, &node->if_statement.body, scope, file);
         }
-        else if(node->if_statement.else_body != NULL)
+        else if(e_list_len(&node->if_statement.else_body) != 0)
         {
-            result = e_evaluate_body(arena, node->if_statement.else_body, scope, file);
+            result = e_evaluate_body(arena, &node->if_statement.else_body, scope, file);
         }
 
         // return (eResult) {.value = {0}, .is_void = true, .is_return = false};
@@ -264,7 +972,7 @@ eResult e_evaluate(eArena *arena, eASTNode *node, eScope *scope, eFileState *fil
 
         while(condition.value.boolean)
         {
-            e_evaluate_body(arena, node->while_loop.body, scope, file);
+            e_evaluate_body(arena, &node->while_loop.body, scope, file);
 
             condition = e_evaluate(arena, node->while_loop.condition, scope, file);
         }
@@ -285,7 +993,11 @@ eResult e_evaluate(eArena *arena, eASTNode *node, eScope *scope, eFileState *fil
 
     case AST_CONDITION: {
         eResult lhs = e_evaluate(arena, node->condition.lhs, scope, file);
+
+        // Keep the left side alive while the right side is evaluated
+        e_value_retain(lhs.value);
         eResult rhs = e_evaluate(arena, node->condition.rhs, scope, file);
+        e_value_release(scope, lhs.value);
 
         switch(node->condition.op)
         {
@@ -344,10 +1056,17 @@ eResult e_evaluate(eArena *arena, eASTNode *node, eScope *scope, eFileState *fil
         }
     }
 
-    case AST_FUNCTION_DECL:
-        e_declare_function(arena, node->function_decl, scope, file);
+    case AST_FUNCTION_DECL: {
+        eASTFunctionDecl declaration = node->function_decl;
+        if(declaration.is_extern)
+        {
+            declaration.native = e_ffi_bind(scope->vm->natives, &declaration);
+        }
+
+        e_declare_function(arena, declaration, scope, file);
 
         return (eResult) {.value = {0}, .is_void = true, .is_return = false};
+    }
 
     case AST_RETURN: {
         if(scope->function == NULL)
@@ -372,57 +1091,95 @@ eResult e_evaluate(eArena *arena, eASTNode *node, eScope *scope, eFileState *fil
     case AST_IMPORT: {
         eString path = e_string_slice(node->import_stmt.path, 1, node->import_stmt.path.len - 2);
 
-        eFileState imported = {
-            .path = path,
-            .is_main = false
-        };
-
         eString current_path = e_string_slice_file_path(file->path);
         eString exec_path = e_string_combine(arena, current_path, path);
 
-        e_exec_file(exec_path, scope, file);
+        eModule *module = e_module_import(scope, exec_path);
+
+        eImport *existing = find_import(node->import_stmt.identifier, scope);
+        if(existing != NULL)
+        {
+            // Running the same import statement again only finds the module in the cache
+            if(existing->module != module)
+            {
+                THROW_ERROR(RUNTIME_ERROR, "name conflict", 0l);
+            }
+
+            return (eResult) {.value = {0}, .is_void = true, .is_return = false};
+        }
+
+        e_list_push(&scope->allocator, &scope->imports, &(eImport) {
+            .identifier = node->import_stmt.identifier,
+            .module = module
+        }, sizeof(eImport));
 
         return (eResult) {.value = {0}, .is_void = true, .is_return = false};
     }
 
+    case AST_MEMBER: {
+        eMember *member = resolve_member(node, scope);
+        if(member->kind != MEMBER_VARIABLE)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "member is not a variable", 0l);
+        }
+
+        return (eResult) {
+            .value = member->variable->value,
+            .is_void = false,
+            .is_return = false
+        };
+    }
+
     default: {
         THROW_ERROR(RUNTIME_ERROR, "unknown expression", 0l);
     }
     }
 }
 
-eResult e_evaluate_body(eArena *arena, eListNode *body, eScope *scope, eFileState *file)
+eResult e_evaluate_body(eArena *arena, eList *body, eScope *scope, eFileState *file)
 {
-    eListNode *current = body;
-    while(current != NULL)
+    eSourceLocation *location = &scope->vm->location;
+    size_t line = location->line;
+
+    eListIter iter = e_list_iter(body);
+    eASTNode *node;
+    while((node = e_list_next(&iter)) != NULL)
     {
-        eResult result = e_evaluate(arena, (eASTNode *) current->data, scope, file);
+        size_t mark = e_heap_mark(scope->vm->heap);
+
+        location->line = node->line;
+
+        eResult result = e_evaluate(arena, node, scope, file);
         if(result.is_return)
         {
+            // Temporaries stay alive until the caller's statement has finished
+            location->line = line;
+
             return result;
         }
 
-        current = current->next;
+        e_heap_collect(scope->vm->heap, mark);
     }
 
+    // Errors in the condition of a loop belong to the loop
+    location->line = line;
+
     return (eResult) {.value = {0}, .is_void = true, .is_return = false};
 }
 
-static eASTFunctionDecl *get_function(eString identifier, eScope *scope)
+eASTFunctionDecl *e_get_function(eString identifier, eScope *scope)
 {
     eScope *current = scope;
     while(current != NULL)
     {
-        eListNode *current_function = current->functions;
-        while(current_function != NULL)
+        eListIter iter = e_list_iter(&current->functions);
+        eASTFunctionDecl *function;
+        while((function = e_list_next(&iter)) != NULL)
         {
-            eASTFunctionDecl *function = (eASTFunctionDecl *) current_function->data;
             if(e_string_compare(function->identifier, identifier))
             {
                 return function;
             }
-
-            current_function = current_function->next;
         }
 
         current = current->parent;
@@ -433,64 +1190,121 @@ static eASTFunctionDecl *get_function(eString identifier, eScope *scope)
 
 eResult e_call(eArena *arena, eFunctionCall call, eScope *scope, eFileState *file)
 {
-    eASTFunctionDecl *function = get_function(call.identifier, scope);
+    eASTFunctionDecl *function = e_get_function(call.identifier, scope);
     if(function != NULL)
     {
-        if(e_stack_len(&call.args) != e_list_len(function->params))
+        return e_call_function(arena, function, call, scope, file);
+    }
+
+    return e_ffi_call(call.identifier, arena, scope, call.args, call.num_args);
+}
+
+/**
+ * Function scopes are registered with the VM while they run, so that an error can free them
+*/
+static void frame_enter(eScope *fn_scope)
+{
+    fn_scope->prev_frame = fn_scope->vm->frames;
+    fn_scope->vm->frames = fn_scope;
+}
+
+static void frame_leave(eScope *fn_scope)
+{
+    fn_scope->vm->frames = fn_scope->prev_frame;
+
+    e_scope_free(fn_scope);
+}
+
+eResult e_call_function(eArena *arena, eASTFunctionDecl *function, eFunctionCall call, eScope *scope, eFileState *file)
+{
+    if(call.num_args != e_list_len(&function->params))
+    {
+        THROW_ERROR(RUNTIME_ERROR, "wrong amount of arguments provided", 0l);
+    }
+
+    if(function->native != NULL)
+    {
+        // Bound at declaration, only the declared parameter types have to be checked
+        eListIter param_iter = e_list_iter(&function->params);
+        for(size_t i = 0; i < call.num_args; i++)
         {
-            THROW_ERROR(RUNTIME_ERROR, "wrong amount of arguments provided", 0l);
+            eASTFunctionParam *param = e_list_next(&param_iter);
+            if(call.args[i].type != param->value_type)
+            {
+                THROW_ERROR(RUNTIME_ERROR, "type conflict", 0l);
+            }
         }
 
-        // Declare all arguments as variables
-        eScope fn_scope = e_scope_new(scope, function);
-        eListNode *current_param = function->params;
-        for(size_t i = 0; i < e_stack_len(&call.args); i++)
-        {
-            eASTFunctionParam *param = (eASTFunctionParam *) current_param->data;
-            eValue value = E_STACK_POP(&call.args, eValue);
+        return e_ffi_invoke(function->native, arena, scope, call.args, call.num_args);
+    }
 
-            e_declare(&fn_scope.allocator, param->identifier, value, AT_VAR, param->value_type, &fn_scope, file);
+    eVM *vm = scope->vm;
 
-            current_param = current_param->next;
-        }
+    // Declare all arguments as variables
+    eScope fn_scope = e_scope_new(scope, function);
+    frame_enter(&fn_scope);
 
-        // Execute the function
-        eListNode *current = function->body;
-        while(current != NULL)
+    eSourceLocation caller = vm->location;
+    vm->location.path = file->path;
+
+    eListIter param_iter = e_list_iter(&function->params);
+    for(size_t i = 0; i < call.num_args; i++)
+    {
+        eASTFunctionParam *param = e_list_next(&param_iter);
+
+        e_declare(&fn_scope.allocator, param->identifier, call.args[i], AT_VAR, param->value_type, &fn_scope, file);
+    }
+
+    eList *body = &function->body;
+    if(function->lazy_body != NULL)
+    {
+        if(e_parse_lazy_body(function->lazy_body))
         {
-            eASTNode *node = (eASTNode *) current->data;
+            // The folded body is shared by every caller, so names are resolved where the function was declared
+            eScope *owner = function->lazy_body->owner != NULL ? function->lazy_body->owner : scope;
 
-            eResult result = e_evaluate(arena, node, &fn_scope, file);
-            if(result.is_return)
+            eListIter iter = e_list_iter(&function->lazy_body->body);
+            eASTNode *node;
+            while((node = e_list_next(&iter)) != NULL)
             {
-                // Return from function
-                e_scope_free(&fn_scope);
-
-                return result;
+                e_optimize(function->lazy_body->arena, node, owner);
             }
-            
-            current = current->next;
         }
 
-        e_scope_free(&fn_scope);
+        body = &function->lazy_body->body;
+    }
+
+    // Execute the function
+    eListIter iter = e_list_iter(body);
+    eASTNode *node;
+    while((node = e_list_next(&iter)) != NULL)
+    {
+        size_t mark = e_heap_mark(vm->heap);
+
+        vm->location.line = node->line;
 
-        if(function->return_type != VT_VOID)
+        eResult result = e_evaluate(arena, node, &fn_scope, file);
+        if(result.is_return)
         {
-            THROW_ERROR(RUNTIME_ERROR, "no return statement found inside function", 0l);
+            // Return from function
+            frame_leave(&fn_scope);
+            vm->location = caller;
+
+            return result;
         }
 
-        return (eResult) {.value = {0}, .is_void = true, .is_return = false};
+        e_heap_collect(vm->heap, mark);
     }
 
-    // TODO: this is temporary
-    char *user = getenv("HOME");
-    eString userpath = {
-        .ptr = user,
-        .len = strlen(user)
-    };
-    eString libpath = e_string_combine(arena, userpath, (eString) {.ptr = "/.e/libelibrary.so", .len = 18});
+    frame_leave(&fn_scope);
+    vm->location = caller;
+
+    if(function->return_type != VT_VOID)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "no return statement found inside function", 0l);
+    }
 
-    return e_ffi_call(call.identifier, libpath, arena, scope, &call.args);
+    return (eResult) {.value = {0}, .is_void = true, .is_return = false};
 }
 
 void e_declare(eArena *arena, eString identifier, eValue value, eAssignmentType type, eValueType decl_type, eScope *scope, eFileState *file)
@@ -499,17 +1313,15 @@ void e_declare(eArena *arena, eString identifier, eValue value, eAssignmentType
     eScope *current_scope = scope;
     while(current_scope != NULL)
     {
-        eListNode *current = current_scope->variables;
-        while(current != NULL)
+        eListIter iter = e_list_iter(&current_scope->variables);
+        eVariable *var;
+        while((var = e_list_next(&iter)) != NULL)
         {
             // Throw an error if there is already a variable with that name
-            eVariable *var = (eVariable *) current->data;
             if(e_string_compare(var->identifier, identifier))
             {
                 THROW_ERROR(RUNTIME_ERROR, "name conflict", 0l);
             }
-        
-            current = current->next;
         }
 
         current_scope = current_scope->parent;
@@ -520,6 +1332,8 @@ void e_declare(eArena *arena, eString identifier, eValue value, eAssignmentType
         THROW_ERROR(RUNTIME_ERROR, "type conflict", 0l);
     }
 
+    e_value_retain(value);
+
     // Push the variable to the list
     e_list_push(arena, &scope->variables, &(eVariable) {
         .identifier = identifier,
@@ -535,17 +1349,15 @@ void e_declare_function(eArena *arena, eASTFunctionDecl declaration, eScope *sco
     eScope *current_scope = scope;
     while(current_scope != NULL)
     {
-        eListNode *current = scope->functions;
-        while(current != NULL)
+        eListIter iter = e_list_iter(&scope->functions);
+        eASTFunctionDecl *decl;
+        while((decl = e_list_next(&iter)) != NULL)
         {
             // Throw an error if a function with that name already exists
-            eASTFunctionDecl *decl = (eASTFunctionDecl *) current->data;
             if(e_string_compare(decl->identifier, declaration.identifier))
             {
                 THROW_ERROR(RUNTIME_ERROR, "name conflict", 0l);
             }
-
-            current = current->next;
         }
 
         current_scope = current_scope->parent;
@@ -561,10 +1373,10 @@ void e_assign(eArena *arena, eASTAssignment assignment, eScope *scope, eFileStat
     eScope *current_scope = scope;
     while(current_scope != NULL)
     {
-        eListNode *current_var = current_scope->variables;
-        while(current_var != NULL)
+        eListIter iter = e_list_iter(&current_scope->variables);
+        eVariable *var;
+        while((var = e_list_next(&iter)) != NULL)
         {
-            eVariable *var = (eVariable *) current_var->data;
             if(e_string_compare(var->identifier, assignment.identifier))
             {
                 if(var->type == AT_CONST)
@@ -580,12 +1392,12 @@ void e_assign(eArena *arena, eASTAssignment assignment, eScope *scope, eFileStat
                 }
 
                 // Assign
+                e_value_retain(result.value);
+                e_value_release(scope, var->value);
                 var->value = result.value;
 
                 return;
             }
-
-            current_var = current_var->next;
         }
 
         current_scope = current_scope->parent;
@@ -599,16 +1411,14 @@ eValue e_get_value(eString identifier, eScope *scope, eFileState *file)
     eScope *current_scope = scope;
     while(current_scope != NULL)
     {
-        eListNode *current = current_scope->variables;
-        while(current != NULL)
+        eListIter iter = e_list_iter(&current_scope->variables);
+        eVariable *var;
+        while((var = e_list_next(&iter)) != NULL)
         {
-            eVariable *var = (eVariable *) current->data;
             if(e_string_compare(var->identifier, identifier))
             {
                 return var->value;
             }
-
-            current = current->next;
         }
 
         current_scope = current_scope->parent;
@@ -2,9 +2,15 @@
 
 #include "elist.h"
 #include "eparse.h"
+#include "eheap.h"
+#include "eio.h"
 
 typedef struct escope eScope;
 
+typedef struct evm eVM;
+
+typedef struct emodule eModule;
+
 typedef struct
 {
     eValueType type;
@@ -13,7 +19,14 @@ typedef struct
     {
         int integer;
 
-        eString string;
+        struct
+        {
+            eString string;
+
+            eHeapString *owner; // NULL if the string doesn't live on the string heap
+
+            uint32_t hash; // 0 if not computed
+        };
 
         bool boolean;
     };
@@ -38,11 +51,30 @@ typedef struct
     eAssignmentType type;
 } eVariable;
 
+#define INLINE_ARGUMENTS 8
+
+typedef struct eargumentbuffer eArgumentBuffer;
+
+/**
+ * Argument storage of a single call, spills to the heap for more than INLINE_ARGUMENTS arguments.
+ * The arguments are retained until the call has returned
+*/
+struct eargumentbuffer
+{
+    eValue *items;
+    size_t len, size;
+
+    eValue inline_items[INLINE_ARGUMENTS];
+
+    eArgumentBuffer *prev; // Arguments of the call that was being evaluated when this one started
+};
+
 typedef struct
 {
     eString identifier;
 
-    eStack args; // eValue
+    const eValue *args;
+    size_t num_args;
 } eFunctionCall;
 
 typedef struct
@@ -52,17 +84,29 @@ typedef struct
     bool is_main;
 } eFileState;
 
+typedef struct
+{
+    eString identifier; // Name given with "as"
+
+    eModule *module;
+} eImport;
+
 struct escope
 {
     eScope *parent;
 
     eArena allocator;
 
-    eListNode *variables; // eVariable
-    eListNode *functions; // eASTFunctionDecl
+    eVM *vm; // Heap, constant pool, natives, modules and output of the interpreter
+
+    eList variables; // eVariable
+    eList functions; // eASTFunctionDecl
+    eList imports; // eImport
 
     // bool inside_fun; // Wether the scope is inside a function scope
     eASTFunctionDecl *function; // NULL if not inside function
+
+    eScope *prev_frame; // Function scope that was running when this one was entered
 };
 
 /**
@@ -70,16 +114,62 @@ struct escope
 */
 bool e_exec_file(eString path, eScope *scope, eFileState *file);
 
-eScope e_scope_new(/* Nullable */ eScope *parent, /* Nullable */ eASTFunctionDecl *function);
+/**
+ * Executes source text that has to outlive the scope
+*/
+void e_exec_source(eString txt, eScope *scope, eFileState *file);
+
+/**
+ * Executes source that has already been lexed, the tokens are only read so they can be shared.
+ * Both have to outlive the scope
+*/
+void e_exec_tokens(eList tokens, eString txt, eScope *scope, eFileState *file);
+
+/**
+ * Reads a program incrementally and executes every top level statement as soon as it is complete.
+ * Tokens and the AST of executed statements are freed unless they declare functions
+*/
+void e_exec_stream(int fd, eScope *scope, eFileState *file);
+
+eScope e_scope_new(eScope *parent, /* Nullable */ eASTFunctionDecl *function);
+
+/**
+ * Creates a top level scope, used for the main program and for every imported file
+*/
+eScope e_scope_new_root(eVM *vm);
 
 void e_scope_free(eScope *scope);
 
+/**
+ * Copies a string onto the string heap
+*/
+eValue e_value_new_string(eScope *scope, eString contents);
+
+/**
+ * Concatenates two strings, appending in place if a is the most recent string built on its buffer
+*/
+eValue e_value_concat(eScope *scope, eValue a, eValue b);
+
+void e_value_retain(eValue value);
+
+void e_value_release(eScope *scope, eValue value);
+
 eResult e_evaluate(eArena *arena, eASTNode *node, eScope *scope, eFileState *file);
 
-eResult e_evaluate_body(eArena *arena, eListNode *body, eScope *scope, eFileState *file);
+eResult e_evaluate_body(eArena *arena, eList *body, eScope *scope, eFileState *file);
+
+/**
+ * Returns NULL if no function written in e with that name is visible from the scope
+*/
+eASTFunctionDecl *e_get_function(eString identifier, eScope *scope);
 
 eResult e_call(eArena *arena, eFunctionCall call, eScope *scope, eFileState *file);
 
+/**
+ * Calls a function written in e, its body is executed in a child of the given scope
+*/
+eResult e_call_function(eArena *arena, eASTFunctionDecl *function, eFunctionCall call, eScope *scope, eFileState *file);
+
 void e_declare(eArena *arena, eString identifier, eValue value, eAssignmentType type, eValueType decl_type, eScope *scope, eFileState *file);
 
 void e_declare_function(eArena *arena, eASTFunctionDecl declaration, eScope *scope, eFileState *file);
@@ -2,38 +2,361 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#define READ_BUFFER_SIZE 65536
+
+static void unmap(void *ptr, size_t size)
+{
+    munmap(ptr, size);
+}
+
+static void release(void *ptr, size_t size)
+{
+    free(ptr);
+}
+
+eString e_read_fd(eArena *arena, int fd)
+{
+    size_t size = READ_BUFFER_SIZE;
+    size_t len = 0;
+    char *buffer = malloc(size);
+
+    while(buffer != NULL)
+    {
+        if(len == size)
+        {
+            size *= 2;
+            char *bigger = realloc(buffer, size);
+            if(!bigger)
+            {
+                free(buffer);
+                buffer = NULL;
+
+                break;
+            }
+
+            buffer = bigger;
+        }
+
+        ssize_t n = read(fd, buffer + len, size - len);
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(n < 0)
+        {
+            free(buffer);
+            buffer = NULL;
+
+            break;
+        }
+
+        if(n == 0)
+        {
+            break;
+        }
+
+        len += n;
+    }
+
+    if(buffer == NULL)
+    {
+        return (eString) {.ptr = NULL, .len = 0};
+    }
+
+    e_arena_attach(arena, buffer, size, release);
+
+    return (eString) {.ptr = buffer, .len = len};
+}
 
 eString e_read_file(eArena *arena, eString path)
 {
-    eArena tmp = e_arena_new(64);
-    char *str = e_arena_alloc(arena, path.len + 1);
-    memcpy(str, path.ptr, path.len);
-    str[path.len] = '\0';
+    char *str = strndup(path.ptr, path.len);
+    int fd = open(str, O_RDONLY);
+    free(str);
 
-    FILE *fp = fopen(str, "rb");
-    if(!fp)
+    if(fd < 0)
     {
-        fprintf(stderr, "Failed to open file: %s\n", str);
-        exit(-1);
+        return (eString) {.ptr = NULL, .len = 0};
     }
 
-    fseek(fp, 0, SEEK_END);
-    long len = ftell(fp);
+    struct stat info;
+    if(fstat(fd, &info) != 0)
+    {
+        close(fd);
+
+        return (eString) {.ptr = NULL, .len = 0};
+    }
+
+    if(!S_ISREG(info.st_mode))
+    {
+        eString txt = e_read_fd(arena, fd);
+        close(fd);
 
-    fseek(fp, 0, SEEK_SET);
+        return txt;
+    }
 
-    eString txt = e_string_alloc(arena, len + 1);
-    if(!txt.ptr)
+    if(info.st_size == 0)
     {
-        fprintf(stderr, "Failed to read file: %s\n", str);
+        close(fd);
+
+        return (eString) {.ptr = "", .len = 0};
+    }
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    // The whole file is about to be lexed, so fault it in up front
+    flags |= MAP_POPULATE;
+#endif
+
+    void *data = mmap(NULL, info.st_size, PROT_READ, flags, fd, 0);
+    if(data == MAP_FAILED)
+    {
+        // Some file systems can't be mapped
+        eString txt = e_read_fd(arena, fd);
+        close(fd);
+
+        return txt;
+    }
+
+    close(fd);
+
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+    e_arena_attach(arena, data, info.st_size, unmap);
+
+    return (eString) {.ptr = data, .len = info.st_size};
+}
+
+// Outputs of all interpreters, which may live on different threads
+static eOutput *outputs = NULL;
+static bool registered = false;
+static pthread_mutex_t outputs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void flush_all(void)
+{
+    pthread_mutex_lock(&outputs_lock);
+
+    for(eOutput *current = outputs; current != NULL; current = current->next)
+    {
+        e_output_flush(current);
+    }
+
+    pthread_mutex_unlock(&outputs_lock);
+}
+
+static void write_all(int fd, struct iovec *iov, int count)
+{
+    while(count > 0)
+    {
+        ssize_t written = writev(fd, iov, count);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            // The reader went away, there is nobody left to report to
+            return;
+        }
+
+        // Skip what has been written
+        while(count > 0 && (size_t) written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+
+        if(count > 0)
+        {
+            iov->iov_base = (char *) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+static eOutput *output_new(int fd, eOutputSink sink, void *user)
+{
+    eOutput *output = calloc(1, sizeof(eOutput));
+    char *buffer = malloc(E_OUTPUT_BUFFER_SIZE);
+    if(!output || !buffer)
+    {
+        fprintf(stderr, "Failed to allocate output buffer\n");
         exit(-1);
     }
 
-    fread(txt.ptr, 1, len, fp);
+    output->buffer = buffer;
+    output->fd = fd;
+    output->sink = sink;
+    output->user = user;
+    output->line_buffered = fd >= 0 && isatty(fd);
 
-    fclose(fp);
+    pthread_mutex_lock(&outputs_lock);
+
+    output->next = outputs;
+    outputs = output;
+
+    if(!registered)
+    {
+        atexit(flush_all);
+        registered = true;
+    }
 
-    e_arena_free(&tmp);
+    pthread_mutex_unlock(&outputs_lock);
 
-    return txt;
+    return output;
+}
+
+eOutput *e_output_new(int fd)
+{
+    return output_new(fd, NULL, NULL);
+}
+
+eOutput *e_output_new_sink(eOutputSink sink, void *user)
+{
+    return output_new(-1, sink, user);
+}
+
+void e_output_free(eOutput *output)
+{
+    e_output_flush(output);
+
+    pthread_mutex_lock(&outputs_lock);
+
+    eOutput **current = &outputs;
+    while(*current != NULL)
+    {
+        if(*current == output)
+        {
+            *current = output->next;
+
+            break;
+        }
+
+        current = &(*current)->next;
+    }
+
+    pthread_mutex_unlock(&outputs_lock);
+
+    free(output->buffer);
+    free(output);
+}
+
+void e_output_write(eOutput *output, const char *data, size_t len)
+{
+    if(output->len + len > E_OUTPUT_BUFFER_SIZE)
+    {
+        if(len >= E_OUTPUT_BUFFER_SIZE / 2)
+        {
+            // Large strings are written directly together with what's already buffered
+            struct iovec iov[2] = {
+                {.iov_base = output->buffer, .iov_len = output->len},
+                {.iov_base = (void *) data, .iov_len = len}
+            };
+
+            if(output->sink != NULL)
+            {
+                output->sink(output->user, output->buffer, output->len);
+                output->sink(output->user, data, len);
+            }
+            else
+            {
+                write_all(output->fd, iov, 2);
+            }
+
+            output->len = 0;
+
+            return;
+        }
+
+        e_output_flush(output);
+    }
+
+    memcpy(output->buffer + output->len, data, len);
+    output->len += len;
+
+    if(output->line_buffered && memchr(data, '\n', len) != NULL)
+    {
+        e_output_flush(output);
+    }
+}
+
+void e_output_write_int(eOutput *output, long value)
+{
+    char buffer[24];
+    char *end = buffer + sizeof(buffer);
+    char *ptr = end;
+
+    unsigned long magnitude = value < 0 ? -(unsigned long) value : (unsigned long) value;
+
+    do
+    {
+        *--ptr = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude != 0);
+
+    if(value < 0)
+    {
+        *--ptr = '-';
+    }
+
+    e_output_write(output, ptr, end - ptr);
+}
+
+void e_output_flush(eOutput *output)
+{
+    if(output->len == 0)
+    {
+        return;
+    }
+
+    if(output->sink != NULL)
+    {
+        output->sink(output->user, output->buffer, output->len);
+    }
+    else
+    {
+        struct iovec iov = {.iov_base = output->buffer, .iov_len = output->len};
+        write_all(output->fd, &iov, 1);
+    }
+
+    output->len = 0;
+}
+
+void e_stream_close(eStream *stream, eStringHeap *heap)
+{
+    if(stream->mapping != NULL)
+    {
+        e_heap_release(heap, stream->mapping);
+    }
+
+    free(stream->buffer);
+
+    if(stream->fd != STDIN_FILENO)
+    {
+        close(stream->fd);
+    }
+
+    *stream = (eStream) {.used = false};
+}
+
+void e_stream_close_all(eStreamTable *table, eStringHeap *heap)
+{
+    for(size_t i = 0; i < E_MAX_STREAMS; i++)
+    {
+        if(table->streams[i].used)
+        {
+            e_stream_close(&table->streams[i], heap);
+        }
+    }
 }
@@ -1,3 +1,103 @@
+#pragma once
+
 #include "estring.h"
+#include "eheap.h"
+#include <stdbool.h>
+
+#define E_OUTPUT_BUFFER_SIZE 65536
+#define E_MAX_STREAMS 64
+
+/**
+ * Buffered writer for the output of a script.
+ * Flushed when the buffer is full, on e_output_flush, on exit and after every line if line buffered
+*/
+typedef struct eoutput eOutput;
+
+/**
+ * Receives flushed output instead of a file descriptor
+*/
+typedef void(* eOutputSink)(void *user, const char *data, size_t len);
+
+struct eoutput
+{
+    int fd; // -1 if a sink is set
+
+    eOutputSink sink;
+    void *user;
+
+    char *buffer;
+    size_t len;
+
+    bool line_buffered;
+
+    eOutput *next; // All open outputs, flushed on exit
+};
+
+/**
+ * Line reader over a mapped file or a buffered file descriptor, opened by scripts through the stream natives
+*/
+typedef struct
+{
+    bool used;
+
+    // Mapped files hand out lines as slices of the mapping
+    eHeapString *mapping;
+    size_t offset;
 
+    // Everything else is read through a buffer
+    int fd;
+    char *buffer;
+    size_t start, end, size;
+    bool at_end;
+} eStream;
+
+/**
+ * Streams of a single interpreter, handles are indices into it
+*/
+typedef struct
+{
+    eStream streams[E_MAX_STREAMS];
+} eStreamTable;
+
+/**
+ * Maps a file read-only, files that can't be mapped are read into a buffer.
+ * The contents stay valid until the arena is freed, the pointer is NULL if the file couldn't be read
+*/
 eString e_read_file(eArena *arena, eString path);
+
+/**
+ * Reads everything up to the end of the input into a growing buffer that is released with the arena.
+ * Used for pipes and other files that can't be mapped
+*/
+eString e_read_fd(eArena *arena, int fd);
+
+/**
+ * Line buffering is enabled if fd refers to a terminal
+*/
+eOutput *e_output_new(int fd);
+
+/**
+ * Output that is handed to a callback whenever it is flushed
+*/
+eOutput *e_output_new_sink(eOutputSink sink, void *user);
+
+/**
+ * Flushes the remaining output
+*/
+void e_output_free(eOutput *output);
+
+void e_output_write(eOutput *output, const char *data, size_t len);
+
+void e_output_write_int(eOutput *output, long value);
+
+void e_output_flush(eOutput *output);
+
+/**
+ * Releases the mapping or the buffer and closes the file descriptor unless it is stdin
+*/
+void e_stream_close(eStream *stream, eStringHeap *heap);
+
+/**
+ * Closes every stream a script has left open
+*/
+void e_stream_close_all(eStreamTable *table, eStringHeap *heap);
@@ -71,7 +71,7 @@ static eToken lex_equals_sign(eString src, size_t start, size_t line)
 {
     eToken tk = {0};
 
-    char c = src.ptr[start + 1];
+    char c = start + 1 < src.len ? src.ptr[start + 1] : '\0';
 
     tk.start = start;
     tk.len = 1;
@@ -119,28 +119,25 @@ done:
 
 static eToken lex_identifier(eString src, size_t start, size_t line)
 {
-    eToken tk = {0};
-
-    for(size_t i = start; i < src.len; i++)
+    // Identifiers may run up to the end of the source
+    size_t end = start;
+    while(end < src.len && (isalnum(src.ptr[end]) || src.ptr[end] == '_'))
     {
-        char c = src.ptr[i];
-
-        if(!isalpha(c))
-        {
-            tk.start = start;
-            tk.len = i - start;
-            tk.line = line;
-            tk.tag = ETK_IDENTIFIER;
+        end++;
+    }
 
-            for(size_t j = 0; j < ARR_LEN(keywords); j++)
-            {
-                if(e_string_compare(keywords[j].text, e_string_slice(src, tk.start, keywords[j].text.len)))
-                {
-                    tk.tag = keywords[j].tag;
+    eToken tk = {
+        .start = start,
+        .len = end - start,
+        .line = line,
+        .tag = ETK_IDENTIFIER
+    };
 
-                    break;
-                }
-            }
+    for(size_t j = 0; j < ARR_LEN(keywords); j++)
+    {
+        if(e_string_compare(keywords[j].text, e_string_slice(src, tk.start, tk.len)))
+        {
+            tk.tag = keywords[j].tag;
 
             break;
         }
@@ -151,24 +148,18 @@ static eToken lex_identifier(eString src, size_t start, size_t line)
 
 static eToken lex_number(eString src, size_t start, size_t line)
 {
-    eToken tk = {0};
-
-    for(size_t i = start; i < src.len; i++)
+    size_t end = start;
+    while(end < src.len && isdigit(src.ptr[end]))
     {
-        char c = src.ptr[i];
-
-        if(!isdigit(c))
-        {
-            tk.start = start;
-            tk.len = i - start;
-            tk.line = line;
-            tk.tag = ETK_NUMBER;
-
-            break;
-        }
+        end++;
     }
 
-    return tk;
+    return (eToken) {
+        .start = start,
+        .len = end - start,
+        .line = line,
+        .tag = ETK_NUMBER
+    };
 }
 
 static eToken lex_string(eString src, size_t start, size_t line)
@@ -190,25 +181,29 @@ static eToken lex_string(eString src, size_t start, size_t line)
         }
         else if(c == '\0' || c == '\n')
         {
-            THROW_ERROR(LEXER_ERROR, "missing quotation mark", line);
-
-            return (eToken) {
-                .tag = ETK_UNKNOWN,
-                .start = start,
-                .line = line,
-                .len = 1
-            };
+            break;
         }
     }
 
+    if(tk.tag != ETK_STRING)
+    {
+        // Also reached if the source ends inside the string
+        THROW_ERROR(LEXER_ERROR, "missing quotation mark", line);
+    }
+
     return tk;
 }
 
-eListNode *e_lex(eArena *arena, eString src)
+eList e_lex(eArena *arena, eString src)
 {
-    eListNode *tokens = NULL;
+    return e_lex_from(arena, src, 1);
+}
 
-    size_t line = 1;
+eList e_lex_from(eArena *arena, eString src, size_t first_line)
+{
+    eList tokens = {0};
+
+    size_t line = first_line;
 
     size_t i = 0;
     while(i < src.len)
@@ -249,7 +244,7 @@ eListNode *e_lex(eArena *arena, eString src)
         {
             tk = lex_equals_sign(src, i, line);
         }
-        else if(isalpha(c))
+        else if(isalpha(c) || c == '_')
         {
             // Identifier
             
@@ -275,5 +270,13 @@ eListNode *e_lex(eArena *arena, eString src)
         }
     }
 
+    // Mapped sources aren't terminated by a zero byte
+    e_list_push(arena, &tokens, &(eToken) {
+        .tag = ETK_EOF,
+        .len = 0,
+        .line = line,
+        .start = i
+    }, sizeof(eToken));
+
     return tokens;
 }
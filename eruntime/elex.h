@@ -5,8 +5,6 @@
 #include <stdint.h>
 #include <stddef.h>
 
-typedef struct etokenlist eTokenList;
-
 typedef enum
 {
     ETK_EOF,
@@ -64,4 +62,9 @@ typedef struct
     size_t line, start, len;
 } eToken;
 
-eListNode *e_lex(eArena *arena, eString src);
+eList e_lex(eArena *arena, eString src);
+
+/**
+ * Lexes source that starts on the given line of a larger input
+*/
+eList e_lex_from(eArena *arena, eString src, size_t first_line);
@@ -2,56 +2,85 @@
 #include <stdlib.h>
 #include <string.h>
 
-void e_list_push(eArena *arena, eListNode **head, void *data, size_t size)
+#define FIRST_CHUNK_SIZE 4
+
+static eListChunk *chunk_new(eArena *arena, size_t size, size_t item_size)
 {
-    eListNode *node = e_arena_alloc(arena, sizeof(eListNode));
-    node->data = e_arena_alloc(arena, size);
-    memcpy(node->data, data, size);
-    node->next = NULL;
+    eListChunk *chunk = e_arena_alloc(arena, sizeof(eListChunk) + size * item_size);
+    chunk->next = NULL;
+    chunk->len = 0;
+    chunk->size = size;
 
-    if(*head == NULL)
-    {
-        *head = node;
+    return chunk;
+}
 
-        return;
+void e_list_push(eArena *arena, eList *list, void *data, size_t size)
+{
+    if(list->tail == NULL)
+    {
+        list->item_size = size;
+        list->head = chunk_new(arena, FIRST_CHUNK_SIZE, size);
+        list->tail = list->head;
     }
-
-    eListNode *current = *head;
-    while(current->next != NULL)
+    else if(list->tail->len >= list->tail->size)
     {
-        current = current->next;
+        list->tail->next = chunk_new(arena, list->tail->size * 2, size);
+        list->tail = list->tail->next;
     }
 
-    current->next = node;
+    memcpy(list->tail->data + list->tail->len * list->item_size, data, size);
+    list->tail->len++;
+    list->len++;
 }
 
-void *e_list_at(eListNode *head, size_t index)
+void *e_list_at(eList *list, size_t index)
 {
-    size_t counter = 0;
-    eListNode *current = head;
-    while(current != NULL)
+    if(index >= list->len)
     {
-        if(counter == index)
-        {
-            return current->data;
-        }
-        
+        return NULL;
+    }
+
+    eListChunk *current = list->head;
+    while(index >= current->len)
+    {
+        index -= current->len;
         current = current->next;
-        counter++;
     }
 
-    return NULL;
+    return current->data + index * list->item_size;
 }
 
-size_t e_list_len(eListNode *head)
+size_t e_list_len(eList *list)
 {
-    size_t counter = 0;
-    eListNode *current = head;
-    while(current != NULL)
+    return list->len;
+}
+
+eListIter e_list_iter(eList *list)
+{
+    return (eListIter) {
+        .chunk = list->head,
+        .index = 0,
+        .item_size = list->item_size
+    };
+}
+
+void *e_list_next(eListIter *iter)
+{
+    if(iter->chunk == NULL)
     {
-        current = current->next;
-        counter++;
+        return NULL;
+    }
+
+    if(iter->index >= iter->chunk->len)
+    {
+        iter->chunk = iter->chunk->next;
+        iter->index = 0;
+
+        if(iter->chunk == NULL || iter->chunk->len == 0)
+        {
+            return NULL;
+        }
     }
 
-    return counter;
+    return iter->chunk->data + iter->index++ * iter->item_size;
 }
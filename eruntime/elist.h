@@ -4,19 +4,48 @@
 #include <stddef.h>
 #include <stdbool.h>
 
-#define E_LIST_AT(_head, _index, _type) ((_type) e_list_at((_head), (_index)))
+#define E_LIST_AT(_list, _index, _type) ((_type) e_list_at((_list), (_index)))
 
-typedef struct elistnode eListNode;
+typedef struct elistchunk eListChunk;
 
-struct elistnode
+/**
+ * A block of items stored inline, every chunk is twice the size of the previous one
+*/
+struct elistchunk
 {
-    void *data;
+    eListChunk *next;
 
-    eListNode *next;
+    size_t len, size;
+
+    char data[];
 };
 
-void e_list_push(eArena *arena, eListNode **head, void *data, size_t size);
+/**
+ * Zero initialize to create an empty list
+*/
+typedef struct
+{
+    eListChunk *head, *tail;
+
+    size_t len, item_size;
+} eList;
+
+typedef struct
+{
+    eListChunk *chunk;
+
+    size_t index, item_size;
+} eListIter;
+
+void e_list_push(eArena *arena, eList *list, void *data, size_t size);
+
+void *e_list_at(eList *list, size_t index);
+
+size_t e_list_len(eList *list);
 
-void *e_list_at(eListNode *head, size_t index);
+eListIter e_list_iter(eList *list);
 
-size_t e_list_len(eListNode *head);
+/**
+ * Returns the next item or NULL if the end of the list has been reached
+*/
+void *e_list_next(eListIter *iter);
@@ -0,0 +1,239 @@
+#include "emodule.h"
+#include "evm.h"
+#include "eerror.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void members_insert(eModule *module, eMember member)
+{
+    uint32_t hash = e_string_hash(member.identifier);
+
+    size_t i = hash & (module->size - 1);
+    while(module->hashes[i] != 0)
+    {
+        i = (i + 1) & (module->size - 1);
+    }
+
+    module->members[i] = member;
+    module->hashes[i] = hash;
+}
+
+/**
+ * Builds the member table once the module has been executed
+*/
+static void members_build(eModule *module)
+{
+    size_t count = e_list_len(&module->scope.functions) + e_list_len(&module->scope.variables) + e_list_len(&module->scope.imports);
+
+    // Keep the load factor below one half
+    module->size = 16;
+    while(module->size < count * 2)
+    {
+        module->size *= 2;
+    }
+
+    module->num_members = count;
+    module->members = malloc(module->size * sizeof(eMember));
+    module->hashes = calloc(module->size, sizeof(uint32_t));
+    if(!module->members || !module->hashes)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to allocate member table", 0l);
+    }
+
+    eListIter iter = e_list_iter(&module->scope.functions);
+    eASTFunctionDecl *function;
+    while((function = e_list_next(&iter)) != NULL)
+    {
+        members_insert(module, (eMember) {.identifier = function->identifier, .kind = MEMBER_FUNCTION, .function = function});
+    }
+
+    iter = e_list_iter(&module->scope.variables);
+    eVariable *variable;
+    while((variable = e_list_next(&iter)) != NULL)
+    {
+        members_insert(module, (eMember) {.identifier = variable->identifier, .kind = MEMBER_VARIABLE, .variable = variable});
+    }
+
+    iter = e_list_iter(&module->scope.imports);
+    eImport *import;
+    while((import = e_list_next(&iter)) != NULL)
+    {
+        members_insert(module, (eMember) {.identifier = import->identifier, .kind = MEMBER_MODULE, .module = import->module});
+    }
+}
+
+eModuleCache *e_module_cache_new(void)
+{
+    eModuleCache *cache = calloc(1, sizeof(eModuleCache));
+    if(!cache)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to allocate module cache", 0l);
+    }
+
+    return cache;
+}
+
+void e_module_cache_free(eModuleCache *cache)
+{
+    // Modules are freed in reverse order, so that nothing is freed before the modules that imported it
+    for(size_t i = cache->len; i > 0; i--)
+    {
+        eModule *module = cache->modules[i - 1];
+
+        e_scope_free(&module->scope);
+
+        free(module->members);
+        free(module->hashes);
+        free(module->path);
+        free(module);
+    }
+
+    free(cache->modules);
+    free(cache);
+}
+
+void e_module_cache_unwind(eModuleCache *cache)
+{
+    for(size_t i = 0; i < cache->len; i++)
+    {
+        eModule *module = cache->modules[i];
+        if(module->state != MODULE_LOADING)
+        {
+            continue;
+        }
+
+        eVM *vm = module->scope.vm;
+
+        e_scope_free(&module->scope);
+        module->scope = e_scope_new_root(vm);
+        module->state = MODULE_UNLOADED;
+    }
+}
+
+eModule *e_module_import(eScope *scope, eString path)
+{
+    eModuleCache *cache = scope->vm->modules;
+
+    char *canonical;
+    if(cache->bundle != NULL)
+    {
+        // Paths inside a bundle are normalized and relative to the main file
+        eArena arena = e_arena_new(256);
+        eString normalized = e_string_normalize_path(&arena, path);
+        canonical = e_bundle_find(cache->bundle, normalized).ptr != NULL ? strndup(normalized.ptr, normalized.len) : NULL;
+        e_arena_free(&arena);
+    }
+    else
+    {
+        char *tmp = strndup(path.ptr, path.len);
+        canonical = realpath(tmp, NULL);
+        free(tmp);
+    }
+
+    if(canonical == NULL)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to import file", 0l);
+    }
+
+    for(size_t i = 0; i < cache->len; i++)
+    {
+        eModule *module = cache->modules[i];
+        if(strcmp(module->path, canonical) == 0)
+        {
+            free(canonical);
+
+            return cache->lazy ? module : e_module_load(module);
+        }
+    }
+
+    if(cache->len >= cache->size)
+    {
+        cache->size = cache->size == 0 ? 8 : cache->size * 2;
+        cache->modules = realloc(cache->modules, cache->size * sizeof(eModule *));
+        if(!cache->modules)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "failed to grow module cache", 0l);
+        }
+    }
+
+    eModule *module = calloc(1, sizeof(eModule));
+    if(!module)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to allocate module", 0l);
+    }
+
+    module->path = canonical;
+    module->file = (eFileState) {
+        .path = {.ptr = canonical, .len = strlen(canonical)},
+        .is_main = false
+    };
+    module->scope = e_scope_new_root(scope->vm);
+    module->state = MODULE_UNLOADED;
+
+    cache->modules[cache->len++] = module;
+
+    return cache->lazy ? module : e_module_load(module);
+}
+
+eModule *e_module_load(eModule *module)
+{
+    switch(module->state)
+    {
+    case MODULE_LOADED:
+        return module;
+
+    case MODULE_LOADING:
+        THROW_ERROR(RUNTIME_ERROR, "circular import", 0l);
+
+    default:
+        break;
+    }
+
+    module->state = MODULE_LOADING;
+
+    eModuleCache *cache = module->scope.vm->modules;
+    if(cache->bundle != NULL)
+    {
+        e_exec_source(e_bundle_find(cache->bundle, module->file.path), &module->scope, &module->file);
+    }
+    else if(cache->sources != NULL)
+    {
+        const eSharedSource *shared = e_source_cache_get(cache->sources, module->path);
+        if(shared == NULL)
+        {
+            THROW_ERROR(RUNTIME_ERROR, "failed to import file", 0l);
+        }
+
+        e_exec_tokens(shared->tokens, shared->source, &module->scope, &module->file);
+    }
+    else if(!e_exec_file(module->file.path, &module->scope, &module->file))
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to import file", 0l);
+    }
+
+    members_build(module);
+    module->state = MODULE_LOADED;
+
+    return module;
+}
+
+eMember *e_module_member(eModule *module, eString identifier, uint32_t hash)
+{
+    if(module->size == 0)
+    {
+        return NULL;
+    }
+
+    size_t i = hash & (module->size - 1);
+    while(module->hashes[i] != 0)
+    {
+        if(module->hashes[i] == hash && e_string_compare(module->members[i].identifier, identifier))
+        {
+            return &module->members[i];
+        }
+
+        i = (i + 1) & (module->size - 1);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "einterpreter.h"
+#include "ebundle.h"
+#include "esourcecache.h"
+
+typedef struct emodulecache eModuleCache;
+
+typedef enum
+{
+    MEMBER_FUNCTION,
+    MEMBER_VARIABLE,
+    MEMBER_MODULE
+} eMemberKind;
+
+typedef enum
+{
+    MODULE_UNLOADED,
+    MODULE_LOADING,
+    MODULE_LOADED
+} eModuleState;
+
+typedef struct
+{
+    eString identifier;
+
+    eMemberKind kind;
+
+    union
+    {
+        eASTFunctionDecl *function;
+        eVariable *variable;
+        eModule *module;
+    };
+} eMember;
+
+/**
+ * A file that has been imported, it is executed once in its own scope
+*/
+struct emodule
+{
+    char *path; // Canonical path
+
+    eFileState file;
+
+    eScope scope;
+
+    eModuleState state; // Using a module while it is loading means the imports are circular
+
+    // Names declared at the top level of the module, hashed once after it has been executed
+    eMember *members;
+    uint32_t *hashes;
+    size_t num_members, size;
+};
+
+/**
+ * Modules that have been imported by an interpreter, keyed by canonical path
+*/
+struct emodulecache
+{
+    eModule **modules;
+    size_t len, size;
+
+    bool lazy; // Imports only register the module, it is executed once one of its members is used
+
+    eBundle *bundle; // Imports are looked up in the bundle instead of the file system, NULL if not running a bundle
+
+    eSourceCache *sources; // Read and lexed files shared with other VMs, NULL if the VM reads its own
+};
+
+eModuleCache *e_module_cache_new(void);
+
+void e_module_cache_free(eModuleCache *cache);
+
+/**
+ * Puts modules that an error interrupted while they were loading back into the unloaded state,
+ * so that the next import executes them again from the start
+*/
+void e_module_cache_unwind(eModuleCache *cache);
+
+/**
+ * Returns the module of the file, the file is only read and executed the first time it is imported.
+ * In lazy mode the module is returned without executing it
+*/
+eModule *e_module_import(eScope *scope, eString path);
+
+/**
+ * Executes the module unless that has already happened
+*/
+eModule *e_module_load(eModule *module);
+
+/**
+ * Returns NULL if the module doesn't declare anything with that name
+*/
+eMember *e_module_member(eModule *module, eString identifier, uint32_t hash);
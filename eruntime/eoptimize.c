@@ -0,0 +1,207 @@
+#include "eoptimize.h"
+#include "evm.h"
+#include <string.h>
+
+static bool is_literal(eASTNode *node)
+{
+    return node->tag == AST_NUMERIC_LITERAL || node->tag == AST_STRING_LITERAL || node->tag == AST_BOOL_LITERAL;
+}
+
+static eValue literal_value(eASTNode *node)
+{
+    switch(node->tag)
+    {
+    case AST_NUMERIC_LITERAL:
+        return (eValue) {.type = VT_INT, .integer = node->numeric_literal.value};
+
+    case AST_STRING_LITERAL:
+        return (eValue) {
+            .type = VT_STRING,
+            .string = node->string_literal.value,
+            .hash = node->string_literal.hash
+        };
+
+    default:
+        return (eValue) {.type = VT_BOOL, .boolean = node->bool_literal.value};
+    }
+}
+
+static eASTNode literal_node(eArena *arena, eValue value, eScope *scope)
+{
+    switch(value.type)
+    {
+    case VT_INT:
+        return (eASTNode) {
+            .tag = AST_NUMERIC_LITERAL,
+            .numeric_literal = {.value = value.integer}
+        };
+
+    case VT_BOOL:
+        return (eASTNode) {
+            .tag = AST_BOOL_LITERAL,
+            .bool_literal = {.value = value.boolean}
+        };
+
+    default: {
+        // Heap strings are freed after the statement and slices might point anywhere, the literal has to live as long as the AST
+        eString string = e_string_alloc(arena, value.string.len);
+        memcpy(string.ptr, value.string.ptr, value.string.len);
+
+        uint32_t hash = e_string_hash(string);
+
+        return (eASTNode) {
+            .tag = AST_STRING_LITERAL,
+            .string_literal = {
+                .value = e_string_pool_intern(scope->vm->pool, string, hash, scope),
+                .hash = hash
+            }
+        };
+    }
+    }
+}
+
+static void optimize_body(eArena *arena, eList *body, eScope *scope)
+{
+    eListIter iter = e_list_iter(body);
+    eASTNode *node;
+    while((node = e_list_next(&iter)) != NULL)
+    {
+        e_optimize(arena, node, scope);
+    }
+}
+
+static void fold_call(eArena *arena, eASTNode *node, eScope *scope)
+{
+    eASTFunctionCall *call = &node->function_call;
+    if(call->base->tag != AST_IDENTIFIER)
+    {
+        return;
+    }
+
+    size_t num_args = e_list_len(&call->arguments);
+    if(num_args > 8)
+    {
+        return;
+    }
+
+    eValue args[8];
+
+    eListIter iter = e_list_iter(&call->arguments);
+    for(size_t i = 0; i < num_args; i++)
+    {
+        eASTNode *arg = e_list_next(&iter);
+        if(!is_literal(arg))
+        {
+            return;
+        }
+
+        args[i] = literal_value(arg);
+    }
+
+    // Functions written in e take precedence over natives
+    if(e_get_function(call->base->identifier, scope) != NULL)
+    {
+        return;
+    }
+
+    eFunctionDef *function = e_ffi_resolve(scope->vm->natives, call->base->identifier);
+    if(function == NULL || !function->pure || function->param_types == NULL)
+    {
+        return;
+    }
+
+    if(function->variadic ? num_args < function->num_args : function->num_args != num_args)
+    {
+        return;
+    }
+
+    for(size_t i = 0; i < function->num_args; i++)
+    {
+        if(function->param_types[i] != VT_ANY && function->param_types[i] != args[i].type)
+        {
+            // Leave the error to the runtime
+            return;
+        }
+    }
+
+    size_t mark = e_heap_mark(scope->vm->heap);
+
+    // The call might sit in code that never runs, an error is only raised if it is executed
+    eErrorTrap trap;
+    e_error_trap_push(&trap, NULL, NULL, NULL);
+    if(setjmp(trap.env) == 0)
+    {
+        eResult result = e_ffi_invoke(function, arena, scope, args, num_args);
+        if(!result.is_void)
+        {
+            size_t line = node->line;
+
+            *node = literal_node(arena, result.value, scope);
+            node->line = line;
+        }
+    }
+    e_error_trap_pop(&trap);
+
+    e_heap_collect(scope->vm->heap, mark);
+}
+
+void e_optimize(eArena *arena, eASTNode *node, eScope *scope)
+{
+    switch(node->tag)
+    {
+    case AST_ARITHMETIC:
+        e_optimize(arena, node->arithmetic.lhs, scope);
+        e_optimize(arena, node->arithmetic.rhs, scope);
+
+        break;
+
+    case AST_CONDITION:
+        e_optimize(arena, node->condition.lhs, scope);
+        e_optimize(arena, node->condition.rhs, scope);
+
+        break;
+
+    case AST_DECLARATION:
+        e_optimize(arena, node->declaration.init, scope);
+
+        break;
+
+    case AST_ASSIGNMENT:
+        e_optimize(arena, node->assignment.init, scope);
+
+        break;
+
+    case AST_FUNCTION_CALL:
+        optimize_body(arena, &node->function_call.arguments, scope);
+
+        fold_call(arena, node, scope);
+
+        break;
+
+    case AST_IF_STATEMENT:
+        e_optimize(arena, node->if_statement.condition, scope);
+        optimize_body(arena, &node->if_statement.body, scope);
+        optimize_body(arena, &node->if_statement.else_body, scope);
+
+        break;
+
+    case AST_WHILE_LOOP:
+        e_optimize(arena, node->while_loop.condition, scope);
+        optimize_body(arena, &node->while_loop.body, scope);
+
+        break;
+
+    case AST_FUNCTION_DECL:
+        optimize_body(arena, &node->function_decl.body, scope);
+
+        break;
+
+    case AST_RETURN:
+        e_optimize(arena, node->return_stmt.arg, scope);
+
+        break;
+
+    default:
+        break;
+    }
+}
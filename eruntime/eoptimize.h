@@ -0,0 +1,9 @@
+#pragma once
+
+#include "einterpreter.h"
+
+/**
+ * Folds calls to pure native functions with literal arguments into literals.
+ * New nodes and strings are allocated from the arena, which has to live as long as the AST
+*/
+void e_optimize(eArena *arena, eASTNode *node, eScope *scope);
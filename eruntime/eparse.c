@@ -14,12 +14,14 @@ eASTNode *e_ast_alloc(eArena *arena, eASTNode node)
     return new;
 }
 
-eParser e_parser_new(eListNode *tokens, eString src)
+eParser e_parser_new(eList tokens, eString src, eStringPool *pool, eScope *owner)
 {
     return (eParser) {
         .tokens = tokens,
         .index = 0,
-        .src = src
+        .src = src,
+        .pool = pool,
+        .owner = owner
     };
 }
 
@@ -64,7 +66,7 @@ static long to_long(const char *txt, size_t n)
 
 static bool accept(eParser *self, eTokenTag tag)
 {
-    if(E_LIST_AT(self->tokens, self->index, eToken *)->tag == tag)
+    if(E_LIST_AT(&self->tokens, self->index, eToken *)->tag == tag)
     {
         self->index++;
 
@@ -81,13 +83,63 @@ static void expect(eParser *self, eTokenTag tag)
         return;
     }
 
-    eToken *tk = E_LIST_AT(self->tokens, self->index, eToken *);
+    eToken *tk = E_LIST_AT(&self->tokens, self->index, eToken *);
     THROW_ERROR(PARSER_ERROR, "unexpected token", tk->line);
 }
 
+/**
+ * Brace-matches a function body without parsing it
+*/
+static eLazyBody *skip_body(eArena *arena, eParser *self)
+{
+    size_t start = self->index;
+
+    expect(self, ETK_L_CURLY_BRACE);
+
+    size_t depth = 1;
+    while(depth > 0)
+    {
+        eToken *tk = E_LIST_AT(&self->tokens, self->index, eToken *);
+        switch(tk->tag)
+        {
+        case ETK_L_CURLY_BRACE:
+            depth++;
+
+            break;
+
+        case ETK_R_CURLY_BRACE:
+            depth--;
+
+            break;
+
+        case ETK_EOF:
+            THROW_ERROR(PARSER_ERROR, "missing closing brace", tk->line);
+
+        default:
+            break;
+        }
+
+        self->index++;
+    }
+
+    eLazyBody *lazy_body = e_arena_alloc(arena, sizeof(eLazyBody));
+    *lazy_body = (eLazyBody) {
+        .tokens = self->tokens,
+        .src = self->src,
+        .pool = self->pool,
+        .owner = self->owner,
+        .start = start,
+        .arena = arena,
+        .parsed = false,
+        .body = {0}
+    };
+
+    return lazy_body;
+}
+
 eASTNode *e_parse_member(eArena *arena, eParser *self)
 {
-    eToken *tk = E_LIST_AT(self->tokens, self->index, eToken *);
+    eToken *tk = E_LIST_AT(&self->tokens, self->index, eToken *);
 
     // Create the member expression
     eASTNode *base = e_ast_alloc(arena, (eASTNode) {
@@ -99,13 +151,15 @@ eASTNode *e_parse_member(eArena *arena, eParser *self)
 
     while(accept(self, ETK_DOT))
     {
-        tk = E_LIST_AT(self->tokens, self->index, eToken *);
+        tk = E_LIST_AT(&self->tokens, self->index, eToken *);
+        eString identifier = e_string_slice(self->src, tk->start, tk->len);
 
         base = e_ast_alloc(arena, (eASTNode) {
             .tag = AST_MEMBER,
             .member = (eASTMember) {
                 .base = base,
-                .identifier = e_string_slice(self->src, tk->start, tk->len)
+                .identifier = identifier,
+                .hash = e_string_hash(identifier)
             }
         });
 
@@ -117,7 +171,7 @@ eASTNode *e_parse_member(eArena *arena, eParser *self)
 
 eASTNode *e_parse_factor(eArena *arena, eParser *self)
 {
-    eToken *tk = E_LIST_AT(self->tokens, self->index, eToken *);
+    eToken *tk = E_LIST_AT(&self->tokens, self->index, eToken *);
 
     if(accept(self, ETK_NUMBER))
     {
@@ -130,10 +184,19 @@ eASTNode *e_parse_factor(eArena *arena, eParser *self)
     }
     else if(accept(self, ETK_STRING))
     {
+        eString value = e_string_slice(self->src, tk->start + 1, tk->len - 2);
+        uint32_t hash = e_string_hash(value);
+
+        if(self->pool != NULL)
+        {
+            value = e_string_pool_intern(self->pool, value, hash, self->owner);
+        }
+
         return e_ast_alloc(arena, (eASTNode) {
             .tag = AST_STRING_LITERAL,
             .string_literal = (eASTStringLiteral) {
-                .value = e_string_slice(self->src, tk->start + 1, tk->len - 2)
+                .value = value,
+                .hash = hash
             }
         });
     }
@@ -145,7 +208,7 @@ eASTNode *e_parse_factor(eArena *arena, eParser *self)
 
         if(accept(self, ETK_L_PAREN))
         {
-            eListNode *arguments = NULL;
+            eList arguments = {0};
             if(!accept(self, ETK_R_PAREN))
             {
                 do
@@ -167,10 +230,7 @@ eASTNode *e_parse_factor(eArena *arena, eParser *self)
             });
         }
 
-        return e_ast_alloc(arena, (eASTNode) {
-            .tag = AST_IDENTIFIER,
-            .identifier = e_string_slice(self->src, tk->start, tk->len)
-        });
+        return member;
     }
     else if(accept(self, ETK_KEYWORD_FALSE))
     {
@@ -207,16 +267,16 @@ eASTNode *e_parse_factor(eArena *arena, eParser *self)
 eASTNode *e_parse_terminal(eArena *arena, eParser *self)
 {
     eASTNode *lhs = e_parse_factor(arena, self);
-    if(self->index >= e_list_len(self->tokens))
+    if(self->index >= e_list_len(&self->tokens))
     {
         return lhs;
     }
 
-    while(E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_ASTERISK ||
-          E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_SLASH ||
-          E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_PERCENT)
+    while(E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_ASTERISK ||
+          E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_SLASH ||
+          E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_PERCENT)
     {
-        eOperation op = get_operation(E_LIST_AT(self->tokens, self->index, eToken *)->tag);
+        eOperation op = get_operation(E_LIST_AT(&self->tokens, self->index, eToken *)->tag);
 
         self->index++;
 
@@ -231,7 +291,7 @@ eASTNode *e_parse_terminal(eArena *arena, eParser *self)
             }
         });
 
-        if(self->index >= e_list_len(self->tokens))
+        if(self->index >= e_list_len(&self->tokens))
         {
             return lhs;
         }
@@ -243,15 +303,15 @@ eASTNode *e_parse_terminal(eArena *arena, eParser *self)
 eASTNode *e_parse_expression(eArena *arena, eParser *self)
 {
     eASTNode *lhs = e_parse_terminal(arena, self);
-    if(self->index >= e_list_len(self->tokens))
+    if(self->index >= e_list_len(&self->tokens))
     {
         return lhs;
     }
 
-    while(E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_PLUS ||
-          E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_MINUS)
+    while(E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_PLUS ||
+          E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_MINUS)
     {
-        eOperation op = get_operation(E_LIST_AT(self->tokens, self->index, eToken *)->tag);
+        eOperation op = get_operation(E_LIST_AT(&self->tokens, self->index, eToken *)->tag);
 
         self->index++;
 
@@ -266,7 +326,7 @@ eASTNode *e_parse_expression(eArena *arena, eParser *self)
             }
         });
 
-        if(self->index >= e_list_len(self->tokens))
+        if(self->index >= e_list_len(&self->tokens))
         {
             return lhs;
         }
@@ -311,16 +371,16 @@ eASTNode *e_parse_conditional_factor(eArena *arena, eParser *self)
     }
 
     eASTNode *lhs = e_parse_expression(arena, self);
-    if(self->index >= e_list_len(self->tokens))
+    if(self->index >= e_list_len(&self->tokens))
     {
         return lhs;
     }
 
-    while(E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_L_ANGLE ||
-          E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_R_ANGLE ||
-          E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_DOUBLE_EQUALS)
+    while(E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_L_ANGLE ||
+          E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_R_ANGLE ||
+          E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_DOUBLE_EQUALS)
     {
-        eCondition op = get_conditional_operator(E_LIST_AT(self->tokens, self->index, eToken *)->tag);
+        eCondition op = get_conditional_operator(E_LIST_AT(&self->tokens, self->index, eToken *)->tag);
 
         self->index++;
 
@@ -335,7 +395,7 @@ eASTNode *e_parse_conditional_factor(eArena *arena, eParser *self)
             }
         });
 
-        if(self->index >= e_list_len(self->tokens))
+        if(self->index >= e_list_len(&self->tokens))
         {
             return lhs;
         }
@@ -347,15 +407,15 @@ eASTNode *e_parse_conditional_factor(eArena *arena, eParser *self)
 eASTNode *e_parse_condition(eArena *arena, eParser *self)
 {
     eASTNode *lhs = e_parse_conditional_factor(arena, self);
-    if(self->index >= e_list_len(self->tokens))
+    if(self->index >= e_list_len(&self->tokens))
     {
         return lhs;
     }
 
-    while(E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_KEYWORD_AND ||
-          E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_KEYWORD_OR)
+    while(E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_KEYWORD_AND ||
+          E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_KEYWORD_OR)
     {
-        eCondition op = get_conditional_operator(E_LIST_AT(self->tokens, self->index, eToken *)->tag);
+        eCondition op = get_conditional_operator(E_LIST_AT(&self->tokens, self->index, eToken *)->tag);
 
         self->index++;
 
@@ -370,7 +430,7 @@ eASTNode *e_parse_condition(eArena *arena, eParser *self)
             }
         });
 
-        if(self->index >= e_list_len(self->tokens))
+        if(self->index >= e_list_len(&self->tokens))
         {
             return lhs;
         }
@@ -415,38 +475,38 @@ static eValueType get_value_type(eTokenTag tag, size_t line)
     }
 }
 
-eASTNode *e_parse_statement(eArena *arena, eParser *self)
+static eASTNode *parse_statement(eArena *arena, eParser *self)
 {
-    if(self->index >= e_list_len(self->tokens))
+    if(self->index >= e_list_len(&self->tokens))
     {
         return e_ast_alloc(arena, (eASTNode) {
             .tag = AST_EOF
         });
     }
 
-    eToken *tk = E_LIST_AT(self->tokens, self->index, eToken *);
+    eToken *tk = E_LIST_AT(&self->tokens, self->index, eToken *);
     if(accept(self, ETK_KEYWORD_VAR) || accept(self, ETK_KEYWORD_CONST))
     {
         // Variable declaration
 
-        eToken *identifier = E_LIST_AT(self->tokens, self->index, eToken *);
+        eToken *identifier = E_LIST_AT(&self->tokens, self->index, eToken *);
 
         expect(self, ETK_IDENTIFIER);
 
         if(accept(self, ETK_DOUBLE_COLON))
         {
-            eToken *type_tk = E_LIST_AT(self->tokens, self->index, eToken *);
+            eToken *type_tk = E_LIST_AT(&self->tokens, self->index, eToken *);
 
             self->index++;
 
-            eValueType value_type = get_value_type(type_tk->tag, 0l);
+            eValueType value_type = get_value_type(type_tk->tag, type_tk->line);
         
             expect(self, ETK_EQUALS);
 
             return e_ast_alloc(arena, (eASTNode) {
                 .tag = AST_DECLARATION,
                 .declaration = (eASTDeclaration) {
-                    .type = get_assignment_type(tk->tag, 0l),
+                    .type = get_assignment_type(tk->tag, tk->line),
                     .init = e_parse_expression(arena, self),
                     .identifier = e_string_slice(self->src, identifier->start, identifier->len),
                     .value_type = value_type
@@ -459,7 +519,7 @@ eASTNode *e_parse_statement(eArena *arena, eParser *self)
         return e_ast_alloc(arena, (eASTNode) {
             .tag = AST_DECLARATION,
             .declaration = (eASTDeclaration) {
-                .type = get_assignment_type(tk->tag, 0l),
+                .type = get_assignment_type(tk->tag, tk->line),
                 .init = e_parse_expression(arena, self),
                 .identifier = e_string_slice(self->src, identifier->start, identifier->len),
                 .value_type = VT_VOID
@@ -474,7 +534,7 @@ eASTNode *e_parse_statement(eArena *arena, eParser *self)
 
         if(accept(self, ETK_L_PAREN))
         {
-            eListNode *arguments = NULL;
+            eList arguments = {0};
             if(!accept(self, ETK_R_PAREN))
             {
                 do
@@ -514,9 +574,9 @@ eASTNode *e_parse_statement(eArena *arena, eParser *self)
             return NULL;
         }
 
-        eListNode *body = e_parse_body(arena, self);
+        eList body = e_parse_body(arena, self);
 
-        eListNode *else_body = NULL;
+        eList else_body = {0};
         if(accept(self, ETK_KEYWORD_ELSE))
         {
             else_body = e_parse_body(arena, self);
@@ -541,11 +601,7 @@ eASTNode *e_parse_statement(eArena *arena, eParser *self)
             return NULL;
         }
 
-        eListNode *body = e_parse_body(arena, self);
-        if(body == NULL)
-        {
-            return NULL;
-        }
+        eList body = e_parse_body(arena, self);
 
         return e_ast_alloc(arena, (eASTNode) {
             .tag = AST_WHILE_LOOP,
@@ -563,18 +619,18 @@ eASTNode *e_parse_statement(eArena *arena, eParser *self)
             is_extern = true;
         }
         
-        eToken *id = E_LIST_AT(self->tokens, self->index, eToken *);
+        eToken *id = E_LIST_AT(&self->tokens, self->index, eToken *);
 
         expect(self, ETK_IDENTIFIER);
         expect(self, ETK_L_PAREN);
 
-        eListNode *params = NULL;
+        eList params = {0};
 
-        if(E_LIST_AT(self->tokens, self->index, eToken *)->tag == ETK_IDENTIFIER)
+        if(E_LIST_AT(&self->tokens, self->index, eToken *)->tag == ETK_IDENTIFIER)
         {
             do
             {
-                eToken *param_tk = E_LIST_AT(self->tokens, self->index, eToken *);
+                eToken *param_tk = E_LIST_AT(&self->tokens, self->index, eToken *);
 
                 self->index++;
 
@@ -582,8 +638,8 @@ eASTNode *e_parse_statement(eArena *arena, eParser *self)
 
                 expect(self, ETK_DOUBLE_COLON);
 
-                eToken *param_type = E_LIST_AT(self->tokens, self->index, eToken *);
-                eValueType value_type = get_value_type(param_type->tag, 0l);
+                eToken *param_type = E_LIST_AT(&self->tokens, self->index, eToken *);
+                eValueType value_type = get_value_type(param_type->tag, param_type->line);
 
                 self->index++;
 
@@ -599,16 +655,17 @@ eASTNode *e_parse_statement(eArena *arena, eParser *self)
         eValueType return_type = VT_VOID;
         if(accept(self, ETK_DOUBLE_COLON))
         {
-            eToken *return_type_tk = E_LIST_AT(self->tokens, self->index, eToken *);
+            eToken *return_type_tk = E_LIST_AT(&self->tokens, self->index, eToken *);
             self->index++;
 
-            return_type = get_value_type(return_type_tk->tag, 0l);
+            return_type = get_value_type(return_type_tk->tag, return_type_tk->line);
         }
 
-        eListNode *body = e_parse_body(arena, self);
-        if(!body)
+        // Extern functions are implemented by a native module and have no body
+        eLazyBody *lazy_body = NULL;
+        if(!is_extern)
         {
-            return NULL;
+            lazy_body = skip_body(arena, self);
         }
 
         return e_ast_alloc(arena, (eASTNode) {
@@ -617,8 +674,10 @@ eASTNode *e_parse_statement(eArena *arena, eParser *self)
                 .identifier = e_string_slice(self->src, id->start, id->len),
                 .return_type = return_type,
                 .params = params,
-                .body = body,
-                .is_extern = true
+                .body = {0},
+                .lazy_body = lazy_body,
+                .is_extern = is_extern,
+                .native = NULL
             }
         });
     }
@@ -633,13 +692,13 @@ eASTNode *e_parse_statement(eArena *arena, eParser *self)
     }
     else if(accept(self, ETK_KEYWORD_IMPORT))
     {
-        eToken *path_tk = E_LIST_AT(self->tokens, self->index, eToken *);
+        eToken *path_tk = E_LIST_AT(&self->tokens, self->index, eToken *);
         eString path = e_string_slice(self->src, path_tk->start, path_tk->len);
 
         expect(self, ETK_STRING);
         expect(self, ETK_KEYWORD_AS);
 
-        eToken *as_tk = E_LIST_AT(self->tokens, self->index, eToken *);
+        eToken *as_tk = E_LIST_AT(&self->tokens, self->index, eToken *);
         expect(self, ETK_IDENTIFIER);
 
         return e_ast_alloc(arena, (eASTNode) {
@@ -662,28 +721,40 @@ eASTNode *e_parse_statement(eArena *arena, eParser *self)
     return NULL;
 }
 
-eListNode *e_parse_body(eArena *arena, eParser *self)
+eASTNode *e_parse_statement(eArena *arena, eParser *self)
+{
+    size_t line = 0;
+    if(self->index < e_list_len(&self->tokens))
+    {
+        line = E_LIST_AT(&self->tokens, self->index, eToken *)->line;
+    }
+
+    eASTNode *node = parse_statement(arena, self);
+    if(node != NULL)
+    {
+        node->line = line;
+    }
+
+    return node;
+}
+
+eList e_parse_body(eArena *arena, eParser *self)
 {
     expect(self, ETK_L_CURLY_BRACE);
 
-    eListNode *stmts = NULL;
+    eList stmts = {0};
 
     if(accept(self, ETK_R_CURLY_BRACE))
     {
-        return NULL;
+        return stmts;
     }
 
     do
     {
         eASTNode *stmt = e_parse_statement(arena, self);
-        if(stmt == NULL)
-        {
-            return NULL;
-        }
-
         if(stmt->tag == AST_EOF)
         {
-            return NULL;
+            THROW_ERROR(PARSER_ERROR, "missing closing brace", stmt->line);
         }
 
         e_list_push(arena, &stmts, stmt, sizeof(eASTNode));
@@ -691,3 +762,22 @@ eListNode *e_parse_body(eArena *arena, eParser *self)
 
     return stmts;
 }
+
+bool e_parse_lazy_body(eLazyBody *lazy_body)
+{
+    if(lazy_body->parsed)
+    {
+        return false;
+    }
+
+    eParser parser = e_parser_new(lazy_body->tokens, lazy_body->src, lazy_body->pool, lazy_body->owner);
+    parser.index = lazy_body->start;
+
+    eMemoryCategory category = e_arena_set_category(lazy_body->arena, EMEM_AST);
+    lazy_body->body = e_parse_body(lazy_body->arena, &parser);
+    e_arena_set_category(lazy_body->arena, category);
+
+    lazy_body->parsed = true;
+
+    return true;
+}
@@ -6,6 +6,10 @@
 
 typedef struct eastnode eASTNode;
 
+typedef struct efunctiondef eFunctionDef;
+
+typedef struct escope eScope;
+
 typedef enum
 {
     AST_EOF,
@@ -35,7 +39,9 @@ typedef enum
     VT_STRING,
     VT_BOOL,
 
-    VT_VOID // Not defined
+    VT_VOID, // Not defined
+
+    VT_ANY // Only used in native function signatures
 } eValueType;
 
 typedef enum
@@ -87,15 +93,15 @@ typedef struct
 {
     eASTNode *condition;
 
-    eListNode *body; // eASTNode *
-    eListNode *else_body; // eASTNode * (NULL if no body)
+    eList body; // eASTNode
+    eList else_body; // eASTNode (empty if no body)
 } eASTIfStatement;
 
 typedef struct
 {
     eASTNode *condition;
 
-    eListNode *body;
+    eList body; // eASTNode
 } eASTWhileLoop;
 
 typedef struct
@@ -106,6 +112,8 @@ typedef struct
 typedef struct
 {
     eString value;
+
+    uint32_t hash;
 } eASTStringLiteral;
 
 typedef struct
@@ -130,22 +138,43 @@ typedef struct
     eASTNode *init;
 } eASTAssignment;
 
+/**
+ * A function body that has only been brace-matched, it is parsed on the first call
+*/
+typedef struct
+{
+    eList tokens; // eToken
+    eString src;
+    eStringPool *pool;
+    eScope *owner; // Scope the file was executed in, src lives as long as it and names in the body are folded against it
+
+    size_t start; // Index of the opening brace
+
+    eArena *arena; // Arena the rest of the file was parsed into
+
+    bool parsed;
+    eList body; // eASTNode
+} eLazyBody;
+
 typedef struct
 {
     eString identifier;
     eValueType return_type;
 
-    eListNode *params; // eFunctionParam
-    eListNode *body; // eASTNode *
+    eList params; // eASTFunctionParam
+    eList body; // eASTNode
+
+    eLazyBody *lazy_body; // Used instead of body if not NULL, shared by all copies of the declaration
 
     bool is_extern;
+    eFunctionDef *native; // Bound when the declaration is executed, NULL unless is_extern
 } eASTFunctionDecl;
 
 typedef struct
 {
     eASTNode *base; // identifier or member
 
-    eListNode *arguments; // eASTNode *
+    eList arguments; // eASTNode
 } eASTFunctionCall;
 
 typedef struct
@@ -171,12 +200,16 @@ typedef struct
     eString identifier;
 
     eASTNode *base; // identifier or member
+
+    uint32_t hash; // Hash of the identifier, used to look it up in the member table of a module
 } eASTMember;
 
 struct eastnode
 {
     eASTTag tag;
 
+    size_t line; // Line the statement starts on, 0 for expressions
+
     union
     {
         eASTNumericLiteral numeric_literal;
@@ -213,16 +246,19 @@ struct eastnode
 
 typedef struct
 {
-    eListNode *tokens;
+    eList tokens; // eToken
 
     size_t index;
 
     eString src;
+
+    eStringPool *pool; // Constant pool for string literals, NULL if literals aren't interned
+    eScope *owner; // Scope src belongs to, NULL if it is gone once it has been parsed, see e_string_pool_intern
 } eParser;
 
 eASTNode *e_ast_alloc(eArena *arena, eASTNode node);
 
-eParser e_parser_new(eListNode *tokens, eString src);
+eParser e_parser_new(eList tokens, eString src, /* Nullable */ eStringPool *pool, /* Nullable */ eScope *owner);
 
 eASTNode *e_parse_member(eArena *arena, eParser *self);
 
@@ -238,4 +274,9 @@ eASTNode *e_parse_condition(eArena *arena, eParser *self);
 
 eASTNode *e_parse_statement(eArena *arena, eParser *self);
 
-eListNode *e_parse_body(eArena *arena, eParser *self);
+eList e_parse_body(eArena *arena, eParser *self);
+
+/**
+ * Parses a lazy body unless that has already happened, returns true if it was parsed by this call
+*/
+bool e_parse_lazy_body(eLazyBody *lazy_body);
@@ -0,0 +1,139 @@
+#include "esourcecache.h"
+#include "eerror.h"
+#include "eio.h"
+#include "elex.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void entry_free(eSharedSource *entry)
+{
+    e_arena_free(&entry->arena);
+    free(entry);
+}
+
+static eSharedSource *find(eSourceCache *cache, const char *path)
+{
+    for(size_t i = 0; i < cache->len; i++)
+    {
+        if(strcmp(cache->entries[i]->path, path) == 0)
+        {
+            return cache->entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+eSourceCache *e_source_cache_new(void)
+{
+    eSourceCache *cache = calloc(1, sizeof(eSourceCache));
+    if(!cache)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to allocate source cache", 0l);
+    }
+
+    pthread_rwlock_init(&cache->lock, NULL);
+
+    return cache;
+}
+
+void e_source_cache_free(eSourceCache *cache)
+{
+    for(size_t i = 0; i < cache->len; i++)
+    {
+        entry_free(cache->entries[i]);
+    }
+
+    pthread_rwlock_destroy(&cache->lock);
+
+    free(cache->entries);
+    free(cache);
+}
+
+const eSharedSource *e_source_cache_get(eSourceCache *cache, const char *path)
+{
+    pthread_rwlock_rdlock(&cache->lock);
+    eSharedSource *entry = find(cache, path);
+    pthread_rwlock_unlock(&cache->lock);
+
+    if(entry != NULL)
+    {
+        return entry;
+    }
+
+    // Read and lexed without holding the lock, another thread might be doing the same for the same file
+    entry = calloc(1, sizeof(eSharedSource));
+    if(!entry)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to allocate shared source", 0l);
+    }
+
+    entry->arena = e_arena_new(4096);
+
+    size_t len = strlen(path);
+    entry->path = e_arena_alloc(&entry->arena, len + 1);
+    memcpy(entry->path, path, len + 1);
+
+    eString file = {.ptr = entry->path, .len = len};
+    entry->source = e_read_file(&entry->arena, file);
+    if(!entry->source.ptr)
+    {
+        entry_free(entry);
+
+        return NULL;
+    }
+
+    // The entry is freed before a lexer error is passed on
+    eSourceLocation location = {.path = file, .line = 0};
+
+    eErrorTrap trap;
+    e_error_trap_push(&trap, &location, NULL, NULL);
+    if(setjmp(trap.env) == 0)
+    {
+        entry->tokens = e_lex(&entry->arena, entry->source);
+    }
+    e_error_trap_pop(&trap);
+
+    if(trap.error.kind != NO_ERROR)
+    {
+        entry_free(entry);
+
+        e_error_rethrow(&trap.error);
+    }
+
+    pthread_rwlock_wrlock(&cache->lock);
+
+    eSharedSource *existing = find(cache, path);
+    if(existing == NULL && cache->len >= cache->size)
+    {
+        size_t size = cache->size == 0 ? 16 : cache->size * 2;
+        eSharedSource **entries = realloc(cache->entries, size * sizeof(eSharedSource *));
+        if(!entries)
+        {
+            pthread_rwlock_unlock(&cache->lock);
+            entry_free(entry);
+
+            THROW_ERROR(RUNTIME_ERROR, "failed to grow source cache", 0l);
+        }
+
+        cache->entries = entries;
+        cache->size = size;
+    }
+
+    if(existing == NULL)
+    {
+        cache->entries[cache->len++] = entry;
+    }
+
+    pthread_rwlock_unlock(&cache->lock);
+
+    if(existing != NULL)
+    {
+        // Another thread was faster
+        entry_free(entry);
+
+        return existing;
+    }
+
+    return entry;
+}
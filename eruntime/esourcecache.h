@@ -0,0 +1,41 @@
+#pragma once
+
+#include "estring.h"
+#include "elist.h"
+#include <pthread.h>
+
+/**
+ * A file that has been read and lexed once, it is never modified afterwards
+*/
+typedef struct
+{
+    char *path; // Canonical path
+
+    eString source;
+    eList tokens; // eToken
+
+    eArena arena; // Owns the path, the mapped source and the tokens
+} eSharedSource;
+
+/**
+ * Files shared by several VMs, possibly on different threads.
+ * Only the source and the tokens are shared, every VM parses and executes them on its own
+ * since the AST is optimized against the state of its VM
+*/
+typedef struct
+{
+    eSharedSource **entries;
+    size_t len, size;
+
+    pthread_rwlock_t lock;
+} eSourceCache;
+
+eSourceCache *e_source_cache_new(void);
+
+void e_source_cache_free(eSourceCache *cache);
+
+/**
+ * Returns the file at the canonical path, reading and lexing it the first time it is requested.
+ * Returns NULL if the file couldn't be read, lexer errors are thrown
+*/
+const eSharedSource *e_source_cache_get(eSourceCache *cache, const char *path);
@@ -20,14 +20,14 @@ void e_stack_push(eArena *arena, eStack *stack, void *data)
 {
     if(stack->used + stack->item_size >= stack->size)
     {
-        // THROW_ERROR(RUNTIME_ERROR, "stack overflow", 0l);
+        // The old block belongs to the arena, so it can't be resized in place
+        size_t size = stack->size * 2 + stack->item_size;
+        void *base = e_arena_alloc(arena, size);
+        memcpy(base, stack->base, stack->used);
 
-        stack->base = realloc(stack->base, stack->size * 2 + stack->item_size);
+        stack->base = base;
         stack->ptr = stack->base + stack->used;
-        if(!stack->base)
-        {
-            THROW_ERROR(RUNTIME_ERROR, "failed to realloc stack", 0l);
-        }
+        stack->size = size;
     }
 
     stack->used += stack->item_size;
@@ -1,6 +1,8 @@
 #include "estring.h"
+#include "eerror.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 eString e_string_new(eArena *arena, const char *text)
 {
@@ -88,22 +90,83 @@ eString e_string_slice_file_path(eString str)
     };
 }
 
-bool e_string_compare(eString a, eString b)
+eString e_string_normalize_path(eArena *arena, eString path)
 {
-    if(a.len != b.len)
+    char *result = e_arena_alloc(arena, path.len + 2);
+    size_t len = 0;
+
+    bool absolute = path.len > 0 && path.ptr[0] == '/';
+    if(absolute)
     {
-        return false;
+        result[len++] = '/';
     }
 
-    for(size_t i = 0; i < a.len; i++)
+    size_t root = len; // ".." never removes anything before this
+
+    size_t start = 0;
+    while(start < path.len)
     {
-        if(a.ptr[i] != b.ptr[i])
+        size_t end = start;
+        while(end < path.len && path.ptr[end] != '/')
+        {
+            end++;
+        }
+
+        eString segment = e_string_slice(path, start, end - start);
+        start = end + 1;
+
+        if(segment.len == 0 || (segment.len == 1 && segment.ptr[0] == '.'))
+        {
+            continue;
+        }
+
+        if(segment.len == 2 && segment.ptr[0] == '.' && segment.ptr[1] == '.' && len > root)
         {
-            return false;
+            // Drop the previous segment and its separator
+            while(len > root && result[len - 1] != '/')
+            {
+                len--;
+            }
+
+            if(len > root)
+            {
+                len--;
+            }
+
+            continue;
+        }
+
+        if(len > root)
+        {
+            result[len++] = '/';
+        }
+
+        memcpy(result + len, segment.ptr, segment.len);
+        len += segment.len;
+
+        if(segment.len == 2 && segment.ptr[0] == '.' && segment.ptr[1] == '.')
+        {
+            // Leading ".." segments can't be resolved, they become part of the root
+            root = len;
         }
     }
 
-    return true;
+    result[len] = '\0';
+
+    return (eString) {
+        .ptr = result,
+        .len = len
+    };
+}
+
+bool e_string_compare(eString a, eString b)
+{
+    if(a.len != b.len)
+    {
+        return false;
+    }
+
+    return a.ptr == b.ptr || memcmp(a.ptr, b.ptr, a.len) == 0;
 }
 
 void e_string_print(eString msg)
@@ -113,3 +176,135 @@ void e_string_print(eString msg)
         putc(msg.ptr[i], stdout);
     }
 }
+
+uint32_t e_string_hash(eString str)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < str.len; i++)
+    {
+        hash ^= (unsigned char) str.ptr[i];
+        hash *= 16777619u;
+    }
+
+    return hash == 0 ? 1 : hash;
+}
+
+static void pool_insert(eStringPool *pool, eString str, uint32_t hash, const void *owner)
+{
+    size_t i = hash & (pool->size - 1);
+    while(pool->hashes[i] != 0)
+    {
+        i = (i + 1) & (pool->size - 1);
+    }
+
+    pool->entries[i] = str;
+    pool->hashes[i] = hash;
+    pool->owners[i] = owner;
+    pool->len++;
+}
+
+/**
+ * Rehashes every entry that isn't owned by skip into a table of the given size
+*/
+static void pool_rebuild(eStringPool *pool, size_t size, /* Nullable */ const void *skip)
+{
+    eStringPool old = *pool;
+
+    pool->size = size;
+    pool->len = 0;
+    pool->entries = malloc(pool->size * sizeof(eString));
+    pool->hashes = calloc(pool->size, sizeof(uint32_t));
+    pool->owners = malloc(pool->size * sizeof(void *));
+    if(!pool->entries || !pool->hashes || !pool->owners)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to grow string pool", 0l);
+    }
+
+    for(size_t i = 0; i < old.size; i++)
+    {
+        if(old.hashes[i] != 0 && (skip == NULL || old.owners[i] != skip))
+        {
+            pool_insert(pool, old.entries[i], old.hashes[i], old.owners[i]);
+        }
+    }
+
+    free(old.entries);
+    free(old.hashes);
+    free(old.owners);
+}
+
+static eString pool_copy(eStringPool *pool, eString str)
+{
+    if(pool->storage.regions == NULL)
+    {
+        pool->storage = e_arena_new(4096);
+    }
+
+    eString copy = e_string_alloc(&pool->storage, str.len);
+    memcpy(copy.ptr, str.ptr, str.len);
+
+    return copy;
+}
+
+eString e_string_pool_intern(eStringPool *pool, eString str, uint32_t hash, const void *owner)
+{
+    if(pool->size != 0)
+    {
+        size_t i = hash & (pool->size - 1);
+        while(pool->hashes[i] != 0)
+        {
+            if(pool->hashes[i] == hash && e_string_compare(pool->entries[i], str))
+            {
+                if(pool->owners[i] != NULL && pool->owners[i] != owner)
+                {
+                    pool->entries[i] = pool_copy(pool, pool->entries[i]);
+                    pool->owners[i] = NULL;
+                }
+
+                return pool->entries[i];
+            }
+
+            i = (i + 1) & (pool->size - 1);
+        }
+    }
+
+    // Keep the load factor below one half
+    if((pool->len + 1) * 2 > pool->size)
+    {
+        pool_rebuild(pool, pool->size == 0 ? 64 : pool->size * 2, NULL);
+    }
+
+    eString canonical = owner != NULL ? str : pool_copy(pool, str);
+
+    pool_insert(pool, canonical, hash, owner);
+
+    return canonical;
+}
+
+void e_string_pool_release(eStringPool *pool, const void *owner)
+{
+    for(size_t i = 0; i < pool->size; i++)
+    {
+        if(pool->hashes[i] != 0 && pool->owners[i] == owner)
+        {
+            pool_rebuild(pool, pool->size, owner);
+
+            return;
+        }
+    }
+}
+
+void e_string_pool_free(eStringPool *pool)
+{
+    free(pool->entries);
+    free(pool->hashes);
+    free(pool->owners);
+
+    if(pool->storage.regions != NULL)
+    {
+        e_arena_free(&pool->storage);
+    }
+
+    *pool = (eStringPool) {0};
+}
@@ -3,6 +3,7 @@
 #include "earena.h"
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct
 {
@@ -11,6 +12,21 @@ typedef struct
     size_t len;
 } eString;
 
+/**
+ * Deduplicates strings so that equal strings share the same pointer.
+ * Strings are kept where they are, usually in the source they were read from, and only copied if their source goes away first
+*/
+typedef struct
+{
+    eString *entries;
+    uint32_t *hashes;
+    const void **owners; // What the source of an entry belongs to, NULL if the entry has been copied into storage
+
+    size_t len, size;
+
+    eArena storage; // Copies of strings whose source doesn't live as long as the pool
+} eStringPool;
+
 eString e_string_new(eArena *arena, const char *text);
 
 eString e_string_alloc(eArena *arena, size_t len);
@@ -31,6 +47,31 @@ eString e_string_slice_file_name(eString str);
 */
 eString e_string_slice_file_path(eString str);
 
+/**
+ * Removes "." and empty segments and resolves ".." without touching the file system.
+ * The result is null terminated
+*/
+eString e_string_normalize_path(eArena *arena, eString path);
+
 bool e_string_compare(eString a, eString b);
 
 void e_string_print(eString msg);
+
+/**
+ * Never returns 0 so that 0 can mean "not computed"
+*/
+uint32_t e_string_hash(eString str);
+
+/**
+ * Returns the canonical string with the same contents. If it hasn't been seen yet, str itself becomes canonical
+ * until its owner is released. A NULL owner means that str goes away right after the call, so it is copied.
+ * An entry that is found for a different owner is copied as well, since either owner might be released first
+*/
+eString e_string_pool_intern(eStringPool *pool, eString str, uint32_t hash, /* Nullable */ const void *owner);
+
+/**
+ * Forgets the entries that point into the source of owner, has to be called before it is freed
+*/
+void e_string_pool_release(eStringPool *pool, const void *owner);
+
+void e_string_pool_free(eStringPool *pool);
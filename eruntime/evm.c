@@ -0,0 +1,229 @@
+#include "evm.h"
+#include "eerror.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+eVM *e_vm_new(void)
+{
+    eVM *vm = calloc(1, sizeof(eVM));
+    eStringPool *pool = calloc(1, sizeof(eStringPool));
+    if(!vm || !pool)
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to allocate vm", 0l);
+    }
+
+    vm->heap = e_heap_new(&vm->stats);
+    vm->pool = pool;
+    vm->natives = e_ffi_registry_new();
+    vm->modules = e_module_cache_new();
+    vm->output = e_output_new(STDOUT_FILENO);
+
+    vm->root = e_scope_new_root(vm);
+
+    return vm;
+}
+
+void e_vm_free(eVM *vm)
+{
+    e_stream_close_all(&vm->streams, vm->heap);
+
+    e_scope_free(&vm->root);
+
+    // Modules hold references into the heap
+    e_module_cache_free(vm->modules);
+
+    e_heap_free(vm->heap);
+
+    e_string_pool_free(vm->pool);
+    free(vm->pool);
+
+    e_ffi_registry_free(vm->natives);
+
+    e_output_free(vm->output);
+
+    free(vm);
+}
+
+void e_vm_set_output(eVM *vm, eOutputSink sink, void *user)
+{
+    e_output_free(vm->output);
+
+    vm->output = e_output_new_sink(sink, user);
+}
+
+typedef void(* eProgram)(eVM *vm, eFileState *file, void *data);
+
+/**
+ * Runs a program in the root scope and catches everything it throws
+*/
+static int run(eVM *vm, eFileState *file, eProgram program, void *data)
+{
+    vm->location = (eSourceLocation) {.path = file->path, .line = 0};
+
+    eVMCheckpoint checkpoint = e_vm_checkpoint(vm);
+
+    eErrorTrap trap;
+    e_error_trap_push(&trap, &vm->location, e_vm_unwind, &checkpoint);
+    if(setjmp(trap.env) == 0)
+    {
+        program(vm, file, data);
+    }
+    e_error_trap_pop(&trap);
+
+    vm->error = trap.error;
+    if(trap.error.kind == NO_ERROR)
+    {
+        return 0;
+    }
+
+    // Whatever was printed before the error belongs in front of its message
+    e_output_flush(vm->output);
+
+    return trap.error.kind == PROGRAM_EXIT ? trap.error.code : -1;
+}
+
+static void run_file(eVM *vm, eFileState *file, void *data)
+{
+    if(!e_exec_file(file->path, &vm->root, file))
+    {
+        THROW_ERROR(RUNTIME_ERROR, "failed to open file", 0l);
+    }
+}
+
+static void run_source(eVM *vm, eFileState *file, void *data)
+{
+    e_exec_source(*(eString *) data, &vm->root, file);
+}
+
+static void run_stream(eVM *vm, eFileState *file, void *data)
+{
+    e_exec_stream(*(int *) data, &vm->root, file);
+}
+
+int e_vm_exec_file(eVM *vm, const char *path)
+{
+    eFileState file = {
+        .is_main = true,
+        .path = {.ptr = (char *) path, .len = strlen(path)}
+    };
+
+    return run(vm, &file, run_file, NULL);
+}
+
+int e_vm_exec_source(eVM *vm, const char *source, size_t len, const char *name)
+{
+    // Names and string values point into the source, so it has to live as long as the scope
+    eMemoryCategory category = e_arena_set_category(&vm->root.allocator, EMEM_SOURCE);
+    eString txt = e_string_alloc(&vm->root.allocator, len);
+    memcpy(txt.ptr, source, len);
+
+    eString path = e_string_alloc(&vm->root.allocator, strlen(name));
+    memcpy(path.ptr, name, path.len);
+    e_arena_set_category(&vm->root.allocator, category);
+
+    eFileState file = {
+        .is_main = true,
+        .path = path
+    };
+
+    return run(vm, &file, run_source, &txt);
+}
+
+int e_vm_exec_bundle(eVM *vm, eBundle *bundle)
+{
+    vm->modules->bundle = bundle;
+
+    eFileState file = {
+        .is_main = true,
+        .path = bundle->entries[0].path
+    };
+
+    // The sources are mapped for as long as the bundle is open, they aren't copied
+    eString txt = bundle->entries[0].source;
+
+    return run(vm, &file, run_source, &txt);
+}
+
+int e_vm_exec_stream(eVM *vm, int fd, const char *name)
+{
+    eFileState file = {
+        .is_main = true,
+        .path = {.ptr = (char *) name, .len = strlen(name)}
+    };
+
+    return run(vm, &file, run_stream, &fd);
+}
+
+eVMCheckpoint e_vm_checkpoint(eVM *vm)
+{
+    return (eVMCheckpoint) {
+        .vm = vm,
+        .frames = vm->frames,
+        .arguments = vm->arguments,
+        .mark = e_heap_mark(vm->heap)
+    };
+}
+
+void e_vm_unwind(void *data)
+{
+    eVMCheckpoint *checkpoint = data;
+    eVM *vm = checkpoint->vm;
+
+    // Innermost first, in the order they would have returned in
+    while(vm->frames != checkpoint->frames)
+    {
+        eScope *frame = vm->frames;
+        vm->frames = frame->prev_frame;
+
+        e_scope_free(frame);
+    }
+
+    while(vm->arguments != checkpoint->arguments)
+    {
+        eArgumentBuffer *arguments = vm->arguments;
+        vm->arguments = arguments->prev;
+
+        for(size_t i = 0; i < arguments->len; i++)
+        {
+            e_value_release(&vm->root, arguments->items[i]);
+        }
+
+        if(arguments->items != arguments->inline_items)
+        {
+            free(arguments->items);
+        }
+    }
+
+    e_module_cache_unwind(vm->modules);
+
+    e_heap_collect(vm->heap, checkpoint->mark);
+}
+
+void e_vm_reset(eVM *vm)
+{
+    e_stream_close_all(&vm->streams, vm->heap);
+
+    e_scope_free(&vm->root);
+
+    // Only the temporaries of the main program are left, modules keep their strings referenced
+    e_heap_collect(vm->heap, 0);
+
+    e_output_flush(vm->output);
+
+    vm->root = e_scope_new_root(vm);
+}
+
+void e_vm_unload_modules(eVM *vm)
+{
+    eModuleCache *modules = e_module_cache_new();
+    modules->lazy = vm->modules->lazy;
+    modules->bundle = vm->modules->bundle;
+    modules->sources = vm->modules->sources;
+
+    e_module_cache_free(vm->modules);
+    vm->modules = modules;
+
+    // Module variables were the last references to their strings
+    e_heap_collect(vm->heap, 0);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "einterpreter.h"
+#include "effi.h"
+#include "emodule.h"
+#include "eerror.h"
+
+/**
+ * An independent interpreter. Everything a script can reach is owned by its VM,
+ * so different VMs can be used from different threads at the same time
+*/
+struct evm
+{
+    eMemoryStats stats;
+
+    eStringHeap *heap;
+
+    eStringPool *pool; // Constant pool for string literals
+
+    eNativeRegistry *natives;
+
+    eModuleCache *modules;
+
+    eOutput *output;
+
+    eStreamTable streams; // Opened by scripts, whatever is left open is closed on reset
+
+    eScope root; // Top level scope of the main program
+
+    eSourceLocation location; // Statement that is currently executed
+
+    eScope *frames; // Innermost function scope that is currently executed, NULL at the top level
+
+    eArgumentBuffer *arguments; // Innermost call whose arguments are being evaluated or that is running
+
+    eError error; // Why the last program stopped early, NO_ERROR if it ran to the end
+};
+
+/**
+ * What a VM returns to when an error interrupts a program
+*/
+typedef struct
+{
+    eVM *vm;
+
+    eScope *frames;
+    eArgumentBuffer *arguments;
+
+    size_t mark; // Temporaries on the string heap
+} eVMCheckpoint;
+
+/**
+ * Creates a VM that writes to stdout
+*/
+eVM *e_vm_new(void);
+
+void e_vm_free(eVM *vm);
+
+/**
+ * Sends the output of the VM to a callback instead of stdout, flushes what has been written so far
+*/
+void e_vm_set_output(eVM *vm, eOutputSink sink, void *user);
+
+/**
+ * The functions running a program return its exit status: 0 if it ran to the end, the code it passed to exit,
+ * or -1 if it failed with an error. The VM stays usable afterwards, vm->error describes why the program stopped
+*/
+int e_vm_exec_file(eVM *vm, const char *path);
+
+/**
+ * The source is copied, name is used to resolve imports relative to it
+*/
+int e_vm_exec_source(eVM *vm, const char *source, size_t len, const char *name);
+
+/**
+ * Runs the main file of a bundle, imports are resolved inside of it. The bundle has to outlive the VM
+*/
+int e_vm_exec_bundle(eVM *vm, eBundle *bundle);
+
+/**
+ * Runs a program read incrementally from a file descriptor, see e_exec_stream
+*/
+int e_vm_exec_stream(eVM *vm, int fd, const char *name);
+
+/**
+ * Drops all variables and functions of the main program and closes the streams it left open.
+ * Loaded modules and natives are kept for the next program
+*/
+void e_vm_reset(eVM *vm);
+
+/**
+ * Drops every loaded module, the next program executes its imports again.
+ * Settings of the module cache are kept. Only call it after e_vm_reset, the root scope refers to the old modules
+*/
+void e_vm_unload_modules(eVM *vm);
+
+eVMCheckpoint e_vm_checkpoint(eVM *vm);
+
+/**
+ * Frees the function scopes, arguments and temporaries created since the checkpoint was taken and resets modules that didn't finish loading.
+ * Used as the cleanup of error traps, so it runs while the interrupted functions still exist
+*/
+void e_vm_unwind(void *checkpoint);
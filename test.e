@@ -4,3 +4,10 @@ print(math.isOdd(3))
 print(math.square(8))
 
 print("This code is reachable")
+
+fun neverCalled(): int
+{
+    Bodies are only parsed on their first call, so this one is never checked
+}
+
+print("Syntax errors in functions that are never called are not reported")